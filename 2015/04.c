@@ -5,9 +5,9 @@
  * By: E. Dronkert https://github.com/ednl
  *
  * Compile:
- *    cc -std=c17 -Wall -Wextra -pedantic 04.c
+ *    cc -std=c17 -Wall -Wextra -pedantic 04.c ../md5mine.c ../cores.c ../mymd5.c -lpthread
  * Enable timer:
- *    cc -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c 04.c
+ *    cc -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c ../md5mine.c ../cores.c ../mymd5.c 04.c -lpthread
  * Get minimum runtime from timer output:
  *     n=2000;m=99999999;for((i=0;i<n;++i));do t=$(./a.out|tail -n1|awk '{print $2}');((t<m))&&m=$t&&echo "$m ($i/$n)";done
  * Minimum runtime measurements:
@@ -16,188 +16,25 @@
  *     Raspberry Pi 5 (2.4 GHz)      :   ? ms
  */
 
-#if __APPLE__
-    #include <sys/sysctl.h>  // sysctlbyname
-#elif __linux__
-    #define _GNU_SOURCE  // must come before all includes, not just sched.h
-    #include <sched.h>   // sched_getaffinity
-#endif
 #include <stdio.h>
-#include <stdint.h>     // uint8_t, uint32_t, UINT32_C
-#include <stdbool.h>    // false, true
-#include <stdatomic.h>  // atomic_bool
-#include <pthread.h>    // pthread_create, pthread_join
+#include <stdint.h>     // uint32_t, uint64_t, UINT32_C
+#include <stdbool.h>    // bool
+#include "../md5mine.h"
 #ifdef TIMER
     #include "../startstoptimer.h"
 #endif
 
 // Personalised input from Advent of Code.
 #define INPUT "iwrupvqb"
-#define INPUTLEN 8
 
 // Bit masks to match 5 or 6 zeros at start of 32 hex char digest (little-endian).
-#define MASK5 UINT32_C(0x00F0FFFF)
-#define MASK6 UINT32_C(0x00FFFFFF)
-
-// Arbitrary limit to avoid dynamic allocation of arg array.
-#define MAXTHREADS 32
-
-typedef struct data {
-    uint32_t start, step, mask, result;
-} Data;
-
-// Signal for other threads to exit when the desired value is found in one thread.
-static atomic_bool found = false;
-
-// Number of CPU cores available to this program.
-// Return: value between lo and hi, inclusive.
-static int coresavail(const int lo, const int hi)
-{
-    int n = 0;
-    #if __APPLE__
-        size_t size = sizeof n;
-        sysctlbyname("hw.activecpu", &n, &size, NULL, 0);
-    #elif __linux__
-        cpu_set_t set;
-        CPU_ZERO(&set);
-        sched_getaffinity(0, sizeof set, &set);
-        n = CPU_COUNT(&set);
-    #elif _WIN32
-+       n = atoi(getenv("NUMBER_OF_PROCESSORS") ?: "1");
-    #endif
-    return n < lo ? lo : (n > hi ? hi : n);
-}
+static const uint32_t mask5 = UINT32_C(0x00F0FFFF);
+static const uint32_t mask6 = UINT32_C(0x00FFFFFF);
 
-// Adapted for one-pass short message from https://en.wikipedia.org/wiki/MD5#Algorithm
-static uint32_t md5(unsigned number)
+// Digest starts with the number of zeros given by mask in arg.
+static bool zeros(const uint32_t * const digest, const void * const arg)
 {
-    static const uint32_t rot[64] = {
-        7,12,17,22, 7,12,17,22, 7,12,17,22, 7,12,17,22,
-        5, 9,14,20, 5, 9,14,20, 5, 9,14,20, 5, 9,14,20,
-        4,11,16,23, 4,11,16,23, 4,11,16,23, 4,11,16,23,
-        6,10,15,21, 6,10,15,21, 6,10,15,21, 6,10,15,21};
-    static const uint32_t K[64] = {
-        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
-        0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
-        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
-        0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
-        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
-        0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
-        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
-        0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
-        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
-        0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
-        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
-        0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
-        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
-        0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
-        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
-        0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
-
-    uint8_t chunk[64] = INPUT;  // message is always shorter than 56 bytes, so this is the first and last chunk
-    unsigned msglen = INPUTLEN;
-
-    uint8_t buf[16];
-    unsigned digits = 0;
-    while (number) {
-        buf[digits++] = '0' | (number % 10u);
-        number /= 10u;
-    }
-    while (digits)
-        chunk[msglen++] = buf[--digits];
-    chunk[msglen] = 0x80;  // append magic stop byte
-    chunk[56] = msglen << 3;  // msglen in bits < 256 so only chunk[56] is ok
-
-    // Break 512-bit message into sixteen 32-bit words M[j]
-    uint32_t M[16];
-    for (int j = 0; j < 16; ++j) {
-        int k = j << 2;  // j * 4
-        M[j] = (uint32_t)chunk[k + 3] << 24  // high to low prec: cast, shift, or
-             | (uint32_t)chunk[k + 2] << 16
-             | (uint32_t)chunk[k + 1] <<  8
-             | (uint32_t)chunk[k];
-    }
-
-    uint32_t i = 0, g, A = 0x67452301, B = 0xefcdab89, C = 0x98badcfe, D = 0x10325476;
-    for (; i < 16; ++i) {
-        const uint32_t F = ((B & C) | (~B & D)) + A + K[i] + M[i];
-        A = D;
-        D = C;
-        C = B;
-        B += F << rot[i] | F >> (32 - rot[i]);
-    }
-    for (g = 1; i < 32; ++i, g += 5) {
-        const uint32_t F = ((D & B) | (~D & C)) + A + K[i] + M[g & 0xf];
-        A = D;
-        D = C;
-        C = B;
-        B += F << rot[i] | F >> (32 - rot[i]);
-    }
-    for (g = 5; i < 48; ++i, g += 3) {
-        const uint32_t F = (B ^ C ^ D) + A + K[i] + M[g & 0xf];
-        A = D;
-        D = C;
-        C = B;
-        B += F << rot[i] | F >> (32 - rot[i]);
-    }
-    for (g = 0; i < 64; ++i, g += 7) {
-        const uint32_t F = (C ^ (B | ~D)) + A + K[i] + M[g & 0xf];
-        A = D;
-        D = C;
-        C = B;
-        B += F << rot[i] | F >> (32 - rot[i]);
-    }
-    return A + 0x67452301;  // first 8 hex digits of 32-char hex digest
-}
-
-// Parallel execution in separate threads.
-static void *loop(void *arg)
-{
-    Data *data = arg;
-    uint32_t hash, num = data->start;
-    const uint32_t step = data->step;
-    const uint32_t mask = data->mask;
-
-    while ((hash = (md5(num) & mask)) && !atomic_load(&found))
-        num += step;
-    data->start = num + step;
-    if (hash) {
-        data->result = 0;
-    } else {
-        atomic_store(&found, true);
-        data->result = num;
-    }
-    return NULL;
-}
-
-static uint32_t run(const int part, const int threads)
-{
-    static pthread_t tid[MAXTHREADS];  // thread IDs
-    static Data arg[MAXTHREADS];  // thread arguments going in and out
-
-    // Set arguments
-    if (part == 1)
-        for (int i = 0; i < threads; ++i)
-            arg[i] = (Data){
-                .start = i + 1,  // thread 0 starts at 1, thread 1 at 2, etc.
-                .step = threads,
-                .mask = MASK5  // part 1: 5 zeroes
-            };
-    else
-        for (int i = 0; i < threads; ++i)
-            arg[i].mask = MASK6;  // part 2: 6 zeroes
-    // Launch parallel threads.
-    found = false;
-    for (int i = 0; i < threads; ++i)
-        pthread_create(&tid[i], NULL, loop, &arg[i]);
-    // Wait for threads to stop
-    uint32_t n = 0;
-    for (int i = 0; i < threads; ++i) {
-        pthread_join(tid[i], NULL);
-        if (arg[i].result && (!n || arg[i].result < n))
-            n = arg[i].result;
-    }
-    return n;
+    return !(digest[0] & *(const uint32_t *)arg);
 }
 
 int main(void)
@@ -206,9 +43,11 @@ int main(void)
     starttimer();
 #endif
 
-    const int threads = coresavail(1, MAXTHREADS);
-    printf("Part 1: %u\n", run(1, threads));  // 346386
-    printf("Part 2: %u\n", run(2, threads));  // 9958218
+    // Every match of part 2 is also a match of part 1, so continue from there.
+    const uint64_t part1 = md5mine(INPUT, 1, zeros, &mask5, 0, NULL);
+    const uint64_t part2 = md5mine(INPUT, part1, zeros, &mask6, 0, NULL);
+    printf("Part 1: %llu\n", (unsigned long long)part1);  // 346386
+    printf("Part 2: %llu\n", (unsigned long long)part2);  // 9958218
 
 #ifdef TIMER
     printf("Time: %.0f ms\n", stoptimer_ms());
@@ -5,9 +5,9 @@
  * By: E. Dronkert https://github.com/ednl
  *
  * Compile:
- *     cc -std=c17 -Wall -Wextra -pedantic ../combperm.c 09.c
+ *     cc -std=gnu17 -Wall -Wextra -pedantic ../combperm.c ../cores.c 09.c -lpthread
  * Enable timer:
- *     cc -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c ../combperm.c 09.c
+ *     cc -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c ../combperm.c ../cores.c 09.c -lpthread
  * Get minimum runtime from timer output in bash:
  *     m=99999999;for((i=0;i<20000;++i));do t=$(./a.out|tail -n1|awk '{print $2}');((t<m))&&m=$t&&echo "$m ($i)";done
  * Minimum runtime measurements:
@@ -18,14 +18,53 @@
 
 #include <stdio.h>
 #include <stdlib.h>       // atoi
+#include <stdint.h>       // uint64_t
+#include <stdbool.h>
+#include <pthread.h>      // pthread_create, pthread_join
 #include "../combperm.h"  // my own permutations function
+#include "../cores.h"
 #ifdef TIMER
     #include "../startstoptimer.h"  // my own timing function
 #endif
 
 #define N 8
+#define MAXTHREADS 32  // arbitrary limit to avoid dynamic allocation
+
+typedef struct data {
+    int part, parts;  // which slice of all permutations
+    int min, max;     // result
+    bool ok;          // false if the iterator could not be set up
+} Data;
+
 static int dist[N][N];
 
+// Parallel execution in separate threads: min and max route length of one slice.
+static void *loop(void *arg)
+{
+    Data *data = arg;
+    uint64_t beg, end;
+    combperm_chunk(perm_count(N), data->parts, data->part, &beg, &end);
+    PermIter it;
+    if (!perm_init(&it, N) || !perm_seek(&it, beg)) {
+        perm_free(&it);
+        return NULL;
+    }
+    int min = 1000, max = 0;
+    for (uint64_t r = beg; r < end; ++r) {
+        const int *p = perm_next(&it);
+        int sum = 0;
+        for (int i = 0; i < N - 1; ++i)
+            sum += dist[p[i]][p[i + 1]];
+        if (sum < min) min = sum;
+        if (sum > max) max = sum;
+    }
+    perm_free(&it);
+    data->min = min;
+    data->max = max;
+    data->ok = true;
+    return NULL;
+}
+
 int main(void)
 {
     FILE *f = fopen("../aocinput/2015-09-input.txt", "r");
@@ -46,15 +85,25 @@ int main(void)
     starttimer();
 #endif
 
-    int *p, min = 1000, max = 0;
-    while ((p = permutations(N))) {
-        int sum = 0;
-        for (int i = 0; i < N - 1; ++i)
-            sum += dist[p[i]][p[i + 1]];
-        // min = sum < min ? sum : min;
-        // max = sum > max ? sum : max;
-        if (sum < min) min = sum;
-        if (sum > max) max = sum;
+    // Every thread walks its own contiguous slice of the permutations.
+    pthread_t tid[MAXTHREADS];
+    Data arg[MAXTHREADS];
+    const int threads = coresavail(1, MAXTHREADS);
+    for (int i = 0; i < threads; ++i) {
+        arg[i] = (Data){.part = i, .parts = threads, .min = 1000, .max = 0};
+        pthread_create(&tid[i], NULL, loop, &arg[i]);
+    }
+    int min = 1000, max = 0;
+    bool ok = true;
+    for (int i = 0; i < threads; ++i) {
+        pthread_join(tid[i], NULL);
+        ok &= arg[i].ok;
+        if (arg[i].min < min) min = arg[i].min;
+        if (arg[i].max > max) max = arg[i].max;
+    }
+    if (!ok) {
+        fputs("Out of memory.\n", stderr);
+        return 2;
     }
     printf("%d %d\n", min, max);  // 251 898
 
@@ -18,7 +18,7 @@
 
 #include <stdio.h>   // fopen, fclose, fscanf, printf
 #include <stdlib.h>  // qsort
-#include "../combperm.h"  // my own combinations function
+#include "../combperm.h"  // my own revolving-door combinations
 #ifdef TIMER
     #include "../startstoptimer.h"  // my own timing function
 #endif
@@ -76,12 +76,20 @@ int main(void)
 
     int part1 = 0, part2 = 0, firstbatch = 0;
     for (int k = mintake; k <= maxtake; ++k) {
-        const int *index = NULL;
-        while ((index = combinations(N, k))) {
-            int i = 0, sum = 0;
-            while (i < k && sum < EGGNOG)
-                sum += container[index[i++]];
-            if (i == k && sum == EGGNOG) {
+        // Revolving-door order: one container out, one in, per combination
+        if (k >= N)
+            continue;  // no revolving door for all containers: empty, as before
+        DoorIter it;
+        if (!door_init(&it, N, k))
+            return 4;  // out of memory
+        int sum = 0;
+        for (const int *index; (index = door_next(&it)); ) {
+            if (it.out < 0)
+                for (int i = 0; i < k; ++i)
+                    sum += container[index[i]];  // first combination
+            else
+                sum += container[it.in] - container[it.out];
+            if (sum == EGGNOG) {
                 ++part1;  // count any combination that works
                 if (!firstbatch) {
                     firstbatch = k;
@@ -90,6 +98,7 @@ int main(void)
                     ++part2;  // count working combinations with minimum number of containers
             }
         }
+        door_free(&it);
     }
     printf("%d %d\n", part1, part2);  // 1304 18
 
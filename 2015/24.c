@@ -5,8 +5,8 @@
  * By: E. Dronkert https://github.com/ednl
  *
  * Compile:
- *    clang -std=gnu17 -O3 -march=native -Wall -Wextra 24.c ../combperm.c ../startstoptimer.c
- *    gcc   -std=gnu17 -O3 -march=native -Wall -Wextra 24.c ../combperm.c ../startstoptimer.c
+ *    clang -std=gnu17 -O3 -march=native -Wall -Wextra 24.c ../combperm.c ../cores.c ../startstoptimer.c -lpthread
+ *    gcc   -std=gnu17 -O3 -march=native -Wall -Wextra 24.c ../combperm.c ../cores.c ../startstoptimer.c -lpthread
  * Get minimum runtime:
  *     m=99999999;for((i=0;i<20000;++i));do t=$(./a.out|tail -n1|awk '{print $2}');((t<m))&&m=$t&&echo $m;done
  * Minimum runtime:
@@ -16,13 +16,17 @@
  */
 
 #include <stdio.h>
-#include <stdint.h>       // int64_t
+#include <stdint.h>       // int64_t, uint64_t
 #include <inttypes.h>     // PRId64
-#include "../combperm.h"  // combinations
+#include <stdbool.h>
+#include <pthread.h>      // pthread_create, pthread_join
+#include "../combperm.h"  // revolving-door combinations
 #include "../startstoptimer.h"
+#include "../cores.h"
 
 #define FNAME "../aocinput/2015-24-input.txt"
 #define LINES 30  // actual lines in my input file = 29
+#define MAXTHREADS 32  // arbitrary limit to avoid dynamic allocation
 
 typedef struct data {
     int weight[LINES];
@@ -30,6 +34,13 @@ typedef struct data {
 } Data;
 static Data data;
 
+typedef struct work {
+    int len, groupweight;  // combinations of len packages with this weight
+    int part, parts;       // which slice of all combinations
+    int64_t min_qe;        // result, 0 if none found
+    bool ok;               // false if the iterator could not be set up
+} Work;
+
 static int readinput(void)
 {
     FILE *f = fopen(FNAME, "r");
@@ -46,7 +57,47 @@ static int readinput(void)
     return len;
 }
 
-static int64_t quantum(const int groups)
+// Parallel execution in separate threads: min quantum entanglement of one slice.
+static void *loop(void *arg)
+{
+    Work *w = arg;
+    uint64_t beg, end;
+    combperm_chunk(comb_count(data.len, w->len), w->parts, w->part, &beg, &end);
+    // Revolving-door order: one package out, one in, per combination
+    DoorIter it;
+    if (beg == end) {
+        w->ok = true;  // empty slice
+        return NULL;
+    }
+    if (!door_init(&it, data.len, w->len))
+        return NULL;
+    if (!door_seek(&it, beg)) {
+        door_free(&it);
+        return NULL;
+    }
+    int weight = 0;
+    for (uint64_t r = beg; r < end; ++r) {
+        const int *index = door_next(&it);
+        if (it.out < 0)
+            for (int i = 0; i < w->len; ++i)
+                weight += data.weight[index[i]];  // first combination of slice
+        else
+            weight += data.weight[it.in] - data.weight[it.out];
+        if (weight != w->groupweight)
+            continue;
+        int64_t qe = 1;
+        for (int i = 0; i < w->len; ++i)
+            qe *= data.weight[index[i]];  // product only when needed
+        if (qe < w->min_qe || !w->min_qe)
+            w->min_qe = qe;
+    }
+    door_free(&it);
+    w->ok = true;
+    return NULL;
+}
+
+// Return: min quantum entanglement, or -1 if a thread failed
+static int64_t quantum(const int groups, const int threads)
 {
     // Assumes: groups > 0 && sum % groups == 0
     const int groupweight = data.sum / groups;
@@ -56,17 +107,22 @@ static int64_t quantum(const int groups)
         weight += data.weight[i];  // add from end (start with biggest)
     // Assumes unique solution exists
     int64_t min_qe = 0;
-    for (int *index; !min_qe; ++minlen)
-        while ((index = combinations(data.len, minlen))) {
-            int weight = 0;
-            int64_t qe = 1;
-            for (int i = 0; i < minlen; ++i) {
-                weight += data.weight[index[i]];  // sum
-                qe *= data.weight[index[i]];  // product
-            }
-            if (weight == groupweight && (qe < min_qe || !min_qe))
-                min_qe = qe;
+    for (; !min_qe && minlen < data.len; ++minlen) {
+        // Every thread walks its own contiguous slice of the combinations.
+        pthread_t tid[MAXTHREADS];
+        Work arg[MAXTHREADS];
+        for (int i = 0; i < threads; ++i) {
+            arg[i] = (Work){.len = minlen, .groupweight = groupweight, .part = i, .parts = threads};
+            pthread_create(&tid[i], NULL, loop, &arg[i]);
+        }
+        for (int i = 0; i < threads; ++i) {
+            pthread_join(tid[i], NULL);
+            if (!arg[i].ok)
+                min_qe = -1;
+            else if (min_qe >= 0 && arg[i].min_qe && (arg[i].min_qe < min_qe || !min_qe))
+                min_qe = arg[i].min_qe;
         }
+    }
     return min_qe;
 }
 
@@ -75,7 +131,13 @@ int main(void)
     if (!readinput())
         return 1;  // error
     starttimer();  // exclude disk read (and sum)
-    printf("%"PRId64" %"PRId64"\n", quantum(3), quantum(4));  // 10723906903 74850409
+    const int threads = coresavail(1, MAXTHREADS);
+    const int64_t part1 = quantum(3, threads), part2 = quantum(4, threads);
+    if (part1 < 0 || part2 < 0) {
+        fputs("Out of memory.\n", stderr);
+        return 2;
+    }
+    printf("%"PRId64" %"PRId64"\n", part1, part2);  // 10723906903 74850409
     printf("Time: %.0f us\n", stoptimer_us());
     return 0;
 }
@@ -5,9 +5,9 @@
  * By: E. Dronkert https://github.com/ednl
  *
  * Compile with warnings:
- *     cc -std=c17 -Wall -Wextra -pedantic ../topn.c 04.c
+ *     cc -std=c17 -Wall -Wextra -pedantic 04.c
  * Compile for speed, with timer:
- *     cc -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c ../topn.c 04.c
+ *     cc -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c 04.c
  * Run program:
  *     ./a.out                  read input file from internal file name
  *     ./a.out < input.txt      read input file using redirected input
@@ -51,17 +51,10 @@ typedef union hist {
 static char input[LINES][LINELEN];
 static Hist hist[ALPHLEN];
 
-// Sort combined value descending
+// Sort combined value descending, without indirect calls
 // .count is MSB so is the main sort
 // .bin is LSB, has a-z reversed => ascending for equal .count
-static int int16_desc(const void *p, const void *q)
-{
-    const int16_t a = *(const int16_t *)p;
-    const int16_t b = *(const int16_t *)q;
-    if (a > b) return -1;  // descending
-    if (a < b) return +1;
-    return 0;
-}
+TOPN_DEFINE(topn_int16, int16_t, TOPN_DESC)
 
 // Caesar cipher
 // https://en.wikipedia.org/wiki/Caesar_cipher
@@ -105,7 +98,7 @@ int main(void)
         const char *const id = s;
 
         // Sort histogram
-        topn(hist, CHKSUMLEN, ALPHLEN, sizeof *hist, int16_desc);
+        topn_int16(&hist[0].val, CHKSUMLEN, ALPHLEN);
 
         // Compare checksum to the 5 most frequent letters
         // skip 3 digits + '['
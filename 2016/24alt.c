@@ -19,6 +19,7 @@
 #include <stdio.h>    // fopen, fclose, printf, putchar, puts
 #include <string.h>   // memset
 #include <stdbool.h>  // bool
+#include "../combperm.h"  // PermIter
 #ifdef TIMER
     #include "../startstoptimer.h"
 #endif
@@ -121,25 +122,24 @@ static void showdist(void)
 }
 #endif
 
-static void heapperm(char *a, int k)
+// Shortest routes from 0 via POI 1..7 in every order, serially: only 7! = 5040
+// permutations, too few to be worth starting threads.
+// Return: false if out of memory
+static bool routes(void)
 {
-    if (k == 1) {
-        int d = dist[0][a[0]];
+    PermIter it;
+    if (!perm_init(&it, N - 1))
+        return false;
+    for (const int *a; (a = perm_next(&it)); ) {  // index 0..6 = POI 1..7
+        int d = dist[0][a[0] + 1];
         for (int n = 0; n < N - 2; ++n)
-            d += dist[a[n]][a[n + 1]];
+            d += dist[a[n] + 1][a[n + 1] + 1];
         if (d < mindist1) mindist1 = d;
-        d += dist[a[N - 2]][0];
+        d += dist[a[N - 2] + 1][0];
         if (d < mindist2) mindist2 = d;
-        return;
-    }
-    heapperm(a, --k);
-    for (int i = 0; i < k; ++i) {
-        const int j = (k & 1) * i;
-        const char tmp = a[j];
-        a[j] = a[k];
-        a[k] = tmp;
-        heapperm(a, k);
     }
+    perm_free(&it);
+    return true;
 }
 
 int main(void)
@@ -170,8 +170,10 @@ int main(void)
     showdist();
 #endif
 
-    char a[] = {1,2,3,4,5,6,7};
-    heapperm(a, 7);
+    if (!routes()) {
+        fputs("Out of memory.\n", stderr);
+        return 2;
+    }
     printf("%d %d\n", mindist1, mindist2);  // 490 744
 
 #ifdef TIMER
@@ -6,7 +6,7 @@
  *
  * Compile:
  *     cc -std=c17 -Wall -Wextra -pedantic 05.c
- * Enable debug output:
+ * Enable debug output, also checks part 2 against single steps:
  *     cc -DDEBUG 05.c
  * Enable timer:
  *     cc -std=gnu17 -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c 05.c
@@ -16,12 +16,21 @@
  * Get minimum runtime from timer output:
  *     m=99999999;for((i=0;i<20000;++i));do t=$(./a.out|tail -n1|awk '{print $2}');((t<m))&&m=$t&&echo "$m ($i)";done
  * Minimum runtime measurements:
- *     Macbook Pro 2024 (M4 4.4 GHz) : 31.9 ms
- *     Mac Mini 2020 (M1 3.2 GHz)    : 47.8 ms
- *     Raspberry Pi 5 (2.4 GHz)      : 63.3 ms
+ *     Macbook Pro 2024 (M4 4.4 GHz) : ? ms
+ *     Mac Mini 2020 (M1 3.2 GHz)    : ? ms
+ *     Raspberry Pi 5 (2.4 GHz)      : ? ms
+ *
+ * Part 2: every offset ends up as 2 or 3, and from then on it alternates
+ * between those two values. The prefix of the maze where all offsets are
+ * settled is stored as one bit per offset (1 = jump 3, 0 = jump 2) in
+ * chunks of 8. A lookup table gives, for every chunk state and entry
+ * position, the number of steps through the chunk, the exit position and
+ * the new chunk state. The walker thus crosses settled chunks in one go
+ * and only takes single steps in the unsettled rest of the maze.
  */
 
 #include <stdio.h>
+#include <stdint.h>  // uint8_t, uint16_t
 #include <unistd.h>  // isatty, fileno
 #include <string.h>  // memcpy
 #ifdef TIMER
@@ -30,12 +39,16 @@
 
 #define FNAME "../aocinput/2017-05-input.txt"
 #define N 1200  // needed for my input: 1090
+#define CHUNK 8  // settled offsets per chunk = bits in uint8_t
 
 static int n;
 static int inp[N];
 static int vm1[N];
 static int vm2[N];
+static uint8_t chunk[N / CHUNK];  // settled offsets, bit set = offset 3
+static uint16_t table[1u << CHUNK][CHUNK];  // exit << 12 | steps << 8 | new chunk
 #ifdef DEBUG
+    static int vm3[N];
     static int add[N];
     static int sub[N];
 #endif
@@ -56,21 +69,76 @@ static int part1(void)
     return tick;
 }
 
+// Walk through one chunk with settled offsets, starting at position 'at'
+static uint16_t walk(unsigned bits, int at)
+{
+    unsigned steps = 0;
+    for (; at < CHUNK; ++steps) {
+        const unsigned bit = 1u << at;
+        at += bits & bit ? 3 : 2;
+        bits ^= bit;
+    }
+    return (uint16_t)((unsigned)(at - CHUNK) << 12 | steps << 8 | bits);
+}
+
+static void maketable(void)
+{
+    for (unsigned bits = 0; bits < (1u << CHUNK); ++bits)
+        for (int at = 0; at < CHUNK; ++at)
+            table[bits][at] = walk(bits, at);
+}
+
 static int part2(void)
+{
+    int tick = 0, ip = 0;
+    int fast = 0;  // chunks [0,fast) are settled
+    int lo = 0;    // offsets [0,lo) are settled
+    while (ip >= 0 && ip < n) {
+        // Cross settled chunks in one go
+        // (always forward to the next chunk, so only the entry position
+        // depends on the previous lookup)
+        if (ip < fast * CHUNK) {
+            int c = ip / CHUNK, at = ip % CHUNK;
+            do {
+                const unsigned t = table[chunk[c]][at];
+                chunk[c++] = (uint8_t)t;
+                tick += t >> 8 & 15;
+                at = t >> 12;
+            } while (c < fast);
+            ip = c * CHUNK + at;
+        }
+        if (ip >= n)
+            break;
+        // Single step in unsettled part
+        const int jump = vm2[ip];
+        vm2[ip] += jump < 3 ? 1 : -1;
+        ip += jump;
+        tick++;
+        // Extend settled prefix, convert completed chunks to bits
+        while (lo < n && (vm2[lo] == 2 || vm2[lo] == 3))
+            if (!(++lo % CHUNK)) {
+                unsigned bits = 0;
+                for (int i = 0; i < CHUNK; ++i)
+                    bits |= (unsigned)(vm2[fast * CHUNK + i] == 3) << i;
+                chunk[fast++] = (uint8_t)bits;
+            }
+    }
+    // Write settled chunks back to the maze
+    for (int i = 0; i < fast * CHUNK; ++i)
+        vm2[i] = chunk[i / CHUNK] >> (i % CHUNK) & 1 ? 3 : 2;
+    return tick;
+}
+
+#ifdef DEBUG
+// Part 2 one step at a time, with statistics
+static int part2slow(void)
 {
     int tick = 0;
     for (int ip = 0; ip < n; ++tick)
-        ip += vm2[ip] < 3 ? (
-        #ifdef DEBUG
-            add[ip]++,
-        #endif
-            vm2[ip]++) : (
-        #ifdef DEBUG
-            sub[ip]--,
-        #endif
-            vm2[ip]--);
+        ip += vm3[ip] < 3 ? (add[ip]++, vm3[ip]++) : (sub[ip]--, vm3[ip]--);
     return tick;
 }
+#endif
 
 int main(void)
 {
@@ -96,12 +164,16 @@ int main(void)
     // Two copies to keep original for comparison
     memcpy(vm1, inp, n * sizeof *inp);
     memcpy(vm2, inp, n * sizeof *inp);
+#ifdef DEBUG
+    memcpy(vm3, inp, n * sizeof *inp);
+#endif
 
 #ifdef TIMER
     starttimer();
 #endif
 
     printf("%d\n", part1());  // 388611
+    maketable();
     printf("%d\n", part2());  // 27763113
 
 #ifdef TIMER
@@ -109,10 +181,12 @@ int main(void)
 #endif
 
 #ifdef DEBUG
+    const int slow = part2slow();
     for (int i = 0; i < n; ++i) {
-        printf("    %4d: %5d | %5d %+4d | %5d %+6d %+6d\n",
-            i, inp[i], vm1[i], vm1[i] - inp[i], vm2[i], add[i], sub[i]);
+        printf("    %4d: %5d | %5d %+4d | %5d %+6d %+6d%s\n",
+            i, inp[i], vm1[i], vm1[i] - inp[i], vm3[i], add[i], sub[i], vm2[i] == vm3[i] ? "" : " MISMATCH");
     }
+    printf("single steps: %d\n", slow);
 #endif
 
 #ifdef TIMER
@@ -5,52 +5,278 @@
  * By: E. Dronkert https://github.com/ednl
  *
  * Compile:
- *     cc -std=gnu17 -O3 -march=native -mtune=native ../startstoptimer.c 15.c
+ *     cc -std=gnu17 -O3 -march=native -mtune=native ../startstoptimer.c ../cores.c 15.c -lpthread
+ * Also check against the original serial loops:
+ *     cc -std=gnu17 -O3 -march=native -mtune=native -DDEBUG ../startstoptimer.c ../cores.c 15.c -lpthread
  * Get minimum runtime from timer output:
  *     m=99999999;for((i=0;i<20000;++i));do t=$(./a.out|tail -n1|awk '{print $2}');((t<m))&&m=$t&&echo "$m ($i)";done
  * Minimum runtime measurements:
- *     Macbook Pro 2024 (M4 4.4 GHz) : 153 ms
- *     Mac Mini 2020 (M1 3.2 GHz)    : 246 ms
- *     Raspberry Pi 5 (2.4 GHz)      : 316 ms
+ *     Macbook Pro 2024 (M4 4.4 GHz) : ? ms
+ *     Mac Mini 2020 (M1 3.2 GHz)    : ? ms
+ *     Raspberry Pi 5 (2.4 GHz)      : ? ms
+ *
+ * Both generators are Lehmer generators x -> x * g mod (2^31 - 1), so the
+ * value after k steps is x * g^k: any point in the stream can be reached
+ * directly. The streams are split into independent chunks, several per
+ * thread, and each thread steps its chunks side by side as independent
+ * lanes (instead of one long chain of dependent multiplications).
+ * Part 1 adds up the matches per chunk. Part 2 filters the raw streams of
+ * both generators in parallel rounds, keeps the low 16 bits of every value
+ * that passes, and then zips the two filtered lists.
  */
 
 #include <stdio.h>
+#include <stdlib.h>   // malloc, free
 #include <stdint.h>
+#include <pthread.h>  // pthread_create, pthread_join
 #include "../startstoptimer.h"
+#include "../cores.h"
+
+#define M31 0x7fffffffU  // modulus 2^31 - 1
+#define FA 16807U        // factor of generator A
+#define FB 48271U        // factor of generator B
+#define PAIRS1 40000000  // part 1
+#define PAIRS2  5000000  // part 2
+#define LANES 16         // independent chunks per thread
+#define BLOCK 64         // raw values per lane before filtering in part 2
+#define ROUND (1 << 22)  // raw values per generator per round in part 2
+#define MAXTHREADS 64    // arbitrary limit to avoid dynamic allocation of thread arrays
+
+// Part 1: steps [beg,end) of both generators, starting values at beg
+// Part 2: raw steps [beg,end) of one generator, filtered values to out[]
+typedef struct work {
+    uint64_t a, b;   // start values; part 2: only 'a', 'b' = factor
+    uint64_t mask;   // part 2: filter, value must be multiple of mask + 1
+    int beg, end;
+    uint16_t *out;   // part 2: room for end - beg values
+    int count[LANES];
+} Work;
+
+static int threads;
 
 static uint64_t m31mod(uint64_t g)
 {
-    while (g >= 0x7fffffffU)
-        g = (g & 0x7fffffffU) + (g >> 31);
+    while (g >= M31)
+        g = (g & M31) + (g >> 31);
     return g;
 }
 
+// One generator step without branches: x < 2^31, g < 2^16 so x * g < 2^47,
+// after two folds the result is < 2^31 and never M31 because x != 0
+static inline uint64_t next(uint64_t x, const uint64_t g)
+{
+    x *= g;
+    x = (x & M31) + (x >> 31);
+    return (x & M31) + (x >> 31);
+}
+
+// Jump ahead: g^k mod M31
+static uint64_t m31pow(uint64_t g, int k)
+{
+    uint64_t x = 1;
+    for (; k; k >>= 1, g = m31mod(g * g))
+        if (k & 1)
+            x = m31mod(x * g);
+    return x;
+}
+
+// Split steps [0,len) over threads, lane starting values follow from index
+static int split(Work *const work, const int len)
+{
+    const int t = len / LANES < threads ? 1 : threads;
+    for (int i = 0; i < t; ++i)
+        work[i] = (Work){.beg = (int)((int64_t)len * i / t), .end = (int)((int64_t)len * (i + 1) / t)};
+    return t;
+}
+
+// Run thread function for every work item, in parallel if more than one
+static void runall(void *(*func)(void *), Work *const work, const int count)
+{
+    if (count == 1) {
+        func(&work[0]);
+        return;
+    }
+    pthread_t tid[MAXTHREADS * 2];
+    for (int i = 0; i < count; ++i)
+        pthread_create(&tid[i], NULL, func, &work[i]);
+    for (int i = 0; i < count; ++i)
+        pthread_join(tid[i], NULL);
+}
+
+// Parallel execution in separate threads: part 1 matches in [beg,end)
+static void *chunk1(void *arg)
+{
+    Work *w = arg;
+    const int len = (w->end - w->beg) / LANES;
+    uint64_t a[LANES], b[LANES];
+    for (int i = 0; i < LANES; ++i) {
+        a[i] = m31mod(w->a * m31pow(FA, len * i));
+        b[i] = m31mod(w->b * m31pow(FB, len * i));
+    }
+    int k[LANES] = {0};
+    for (int n = 0; n < len; ++n)
+        for (int i = 0; i < LANES; ++i) {
+            a[i] = next(a[i], FA);
+            b[i] = next(b[i], FB);
+            k[i] += !((a[i] ^ b[i]) & 0xffff);
+        }
+    // Remainder continues in the last lane, which ends at 'end'
+    for (int n = len * LANES; n < w->end - w->beg; ++n) {
+        a[LANES - 1] = next(a[LANES - 1], FA);
+        b[LANES - 1] = next(b[LANES - 1], FB);
+        k[LANES - 1] += !((a[LANES - 1] ^ b[LANES - 1]) & 0xffff);
+    }
+    for (int i = 0; i < LANES; ++i)
+        w->count[i] = k[i];
+    return NULL;
+}
+
+// Parallel execution in separate threads: part 2 filtered values in [beg,end)
+// Lane i writes to out[len * i] onwards, the last lane has room for the remainder
+static void *chunk2(void *arg)
+{
+    Work *w = arg;
+    const int len = (w->end - w->beg) / LANES;
+    const uint64_t g = w->b, mask = w->mask;
+    uint64_t x[LANES];
+    int k[LANES];
+    for (int i = 0; i < LANES; ++i) {
+        x[i] = m31mod(w->a * m31pow(g, len * i));
+        k[i] = len * i;
+    }
+    uint16_t *const out = w->out;
+    // Generate a block of values in all lanes at once, then filter per lane
+    uint64_t raw[BLOCK][LANES];
+    int n = 0;
+    for (; n + BLOCK <= len; n += BLOCK) {
+        for (int j = 0; j < BLOCK; ++j)
+            for (int i = 0; i < LANES; ++i)
+                raw[j][i] = x[i] = next(x[i], g);
+        for (int i = 0; i < LANES; ++i)
+            for (int j = 0; j < BLOCK; ++j) {
+                out[k[i]] = (uint16_t)raw[j][i];
+                k[i] += !(raw[j][i] & mask);
+            }
+    }
+    for (int i = 0; i < LANES; ++i)
+        for (int j = n; j < len; ++j) {
+            x[i] = next(x[i], g);
+            out[k[i]] = (uint16_t)x[i];
+            k[i] += !(x[i] & mask);
+        }
+    // Remainder continues in the last lane, which ends at 'end'
+    for (n = len * LANES; n < w->end - w->beg; ++n) {
+        x[LANES - 1] = next(x[LANES - 1], g);
+        out[k[LANES - 1]] = (uint16_t)x[LANES - 1];
+        k[LANES - 1] += !(x[LANES - 1] & mask);
+    }
+    for (int i = 0; i < LANES; ++i)
+        w->count[i] = k[i] - len * i;
+    return NULL;
+}
+
 static int duel1(uint64_t a, uint64_t b)
 {
+    Work work[MAXTHREADS];
+    const int t = split(work, PAIRS1);
+    for (int i = 0; i < t; ++i) {
+        work[i].a = m31mod(a * m31pow(FA, work[i].beg));
+        work[i].b = m31mod(b * m31pow(FB, work[i].beg));
+    }
+    runall(chunk1, work, t);
+    int k = 0;
+    for (int i = 0; i < t; ++i)
+        for (int j = 0; j < LANES; ++j)
+            k += work[i].count[j];
+    return k;
+}
+
+static int duel2(uint64_t a, uint64_t b)
+{
+    const uint64_t factor[2] = {FA, FB}, mask[2] = {0x3U, 0x7U};
+    uint64_t start[2] = {a, b};
+    uint16_t *val[2], *buf[2];
+    int len[2] = {0};
+    for (int j = 0; j < 2; ++j) {
+        val[j] = malloc(PAIRS2 * sizeof *val[j]);
+        buf[j] = malloc(ROUND * sizeof *buf[j]);
+        if (!val[j] || !buf[j]) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    Work work[MAXTHREADS * 2];
+    while (len[0] < PAIRS2 || len[1] < PAIRS2) {
+        // Next round of raw values for every generator that needs more
+        int n = 0, t = 0;
+        for (int j = 0; j < 2; ++j)
+            if (len[j] < PAIRS2) {
+                t = split(&work[n], ROUND);
+                for (int i = n; i < n + t; ++i) {
+                    work[i].a = m31mod(start[j] * m31pow(factor[j], work[i].beg));
+                    work[i].b = factor[j];
+                    work[i].mask = mask[j];
+                    work[i].out = buf[j] + work[i].beg;
+                }
+                start[j] = m31mod(start[j] * m31pow(factor[j], ROUND));
+                n += t;
+            }
+        runall(chunk2, work, n);
+        // Append filtered values in stream order
+        for (int j = 0, i = 0; j < 2; ++j) {
+            if (len[j] >= PAIRS2)
+                continue;
+            for (int end = i + t; i < end; ++i) {
+                const int lanelen = (work[i].end - work[i].beg) / LANES;
+                for (int l = 0; l < LANES; ++l)
+                    for (int c = 0; c < work[i].count[l] && len[j] < PAIRS2; ++c)
+                        val[j][len[j]++] = work[i].out[lanelen * l + c];
+            }
+        }
+    }
+    // Zip
     int k = 0;
-    for (int n = 40000000; n--; ) {
-        a = m31mod(a * 16807U);
-        b = m31mod(b * 48271U);
+    for (int i = 0; i < PAIRS2; ++i)
+        k += val[0][i] == val[1][i];
+    for (int j = 0; j < 2; ++j) {
+        free(val[j]);
+        free(buf[j]);
+    }
+    return k;
+}
+
+#ifdef DEBUG
+static int duel1serial(uint64_t a, uint64_t b)
+{
+    int k = 0;
+    for (int n = PAIRS1; n--; ) {
+        a = m31mod(a * FA);
+        b = m31mod(b * FB);
         k += !((a ^ b) & 0xffff);
     }
     return k;
 }
 
-static int duel2(uint64_t a, uint64_t b)
+static int duel2serial(uint64_t a, uint64_t b)
 {
     int k = 0;
-    for (int n = 5000000; n--; ) {
-        do a = m31mod(a * 16807U); while (a & 0x3U);
-        do b = m31mod(b * 48271U); while (b & 0x7U);
+    for (int n = PAIRS2; n--; ) {
+        do a = m31mod(a * FA); while (a & 0x3U);
+        do b = m31mod(b * FB); while (b & 0x7U);
         k += !((a ^ b) & 0xffff);
     }
     return k;
 }
+#endif
 
 int main(void)
 {
     starttimer();
+    threads = coresavail(1, MAXTHREADS);
     printf("%d\n", duel1(783, 325));  // 650
     printf("%d\n", duel2(783, 325));  // 336
     printf("Time: %.0f ms\n", stoptimer_ms());
+#ifdef DEBUG
+    printf("serial: %d %d (%d threads)\n", duel1serial(783, 325), duel2serial(783, 325), threads);
+#endif
 }
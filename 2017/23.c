@@ -1,226 +1,81 @@
-#include <stdio.h>     // printf
-#include <stdlib.h>    // malloc, free
+/**
+ * Advent of Code 2017
+ * Day 23: Coprocessor Conflagration
+ * https://adventofcode.com/2017/day/23
+ * By: E. Dronkert https://github.com/ednl
+ *
+ * Compile:
+ *     cc -std=c17 -Wall -Wextra -pedantic ../regvm.c 23.c -lm
+ * Enable timer:
+ *     cc -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c ../regvm.c 23.c -lm
+ * Get minimum runtime from timer output in bash:
+ *     m=99999999;for((i=0;i<20000;++i));do t=$(./a.out|tail -n1|awk '{print $2}');((t<m))&&m=$t&&echo "$m ($i)";done
+ * Minimum runtime measurements:
+ *     Macbook Pro 2024 (M4 4.4 GHz) : ? µs
+ *     Mac Mini 2020 (M1 3.2 GHz)    : ? µs
+ *     Raspberry Pi 5 (2.4 GHz)      : ? µs
+ */
+
+#include <stdio.h>
 #include <stdint.h>    // int64_t
-#include <inttypes.h>  // PRIi64
-#include <string.h>    // strtok, memcpy
-#include <stdbool.h>
+#include <inttypes.h>  // PRId64
 #include <math.h>      // round, sqrt
+#include "../regvm.h"
+#ifdef TIMER
+    #include "../startstoptimer.h"
+#endif
 
-#define MEMSIZE (32)   // number of lines in input
-#define REGBASE ('a')
-#define REGSTOP ('h')
-#define REGSIZE (REGSTOP - REGBASE + 1)
+#define FNAME "../aocinput/2017-23-input.txt"
+#define LOOPSTART 8  // first line after setting the range in b..c
 
-typedef enum opcode {
-    SET,
-    SUB,
-    MUL,
-    JNZ,
-    JMP,
-    NOP,
-} OpCode;
+static RVMachine m;
 
-typedef struct dict {
-    OpCode id;
-    char  *name;
-} Dict, *pDict;
-
-static const Dict cmd[] = {
-    { .id = SET, .name = "set" },
-    { .id = SUB, .name = "sub" },
-    { .id = MUL, .name = "mul" },
-    { .id = JNZ, .name = "jnz" },
-    { .id = JMP, .name = "jmp" },
-    { .id = NOP, .name = "nop" },
-};
-static const int cmdsize = sizeof cmd / sizeof *cmd;
-
-typedef struct instr {
-    OpCode  op;
-    int     r0, r1;
-    int64_t v0, v1;
-} Instr, *pInstr;
-
-typedef struct prog {
-    int      ip;
-    int64_t  tick;
-    int64_t  reg[REGSIZE];
-    Instr    mem[MEMSIZE];
-} Prog, *pProg;
-
-static size_t name2index(const char * s)
+// Part 1: count every executed "mul"
+static bool countmul(RVMachine *const vm, const RVInstr *const ins, void *arg)
 {
-    for (size_t i = 0; i < cmdsize; ++i) {
-        if (!strcmp(cmd[i].name, s)) {
-            return i;
-        }
-    }
-    return 0;
+    (void)vm;
+    *(int64_t *)arg += ins->op == RV_MUL;
+    return true;
 }
 
-static size_t id2index(const OpCode id)
+// Part 2: stop as soon as the range is set up
+static bool setup(RVMachine *const vm, void *arg)
 {
-    if (cmd[id].id == id) {
-        return (size_t)id;
-    }
-    for (size_t i = 0; i < cmdsize; ++i) {
-        if (cmd[i].id == id) {
-            return i;
-        }
-    }
-    return 0;
+    (void)vm; (void)arg;
+    return false;
 }
 
-static Instr assemble(char *code)
-{
-    Instr ins = {
-        .op = NOP,
-        .r0 = -1, .r1 = -1,
-        .v0 =  0, .v1 =  0,
-    };
-    int field = 0;
-    char *s = strtok(code, " ");
-    while (s) {
-        if (field == 0) {
-            size_t i = name2index(s);
-            ins.op = cmd[i].id;
-        } else if (field == 1) {
-            if (*s >= REGBASE && *s <= REGSTOP) {
-                ins.r0 = *s - REGBASE;
-            } else {
-                ins.v0 = atoll(s);  // leave r0 = -1
-                if (ins.op == JNZ) {
-                    ins.op = ins.v0 == 0 ? NOP : JMP;
-                }
-            }
-        } else if (field == 2) {
-            if (*s >= REGBASE && *s <= REGSTOP) {
-                ins.r1 = *s - REGBASE;
-            } else {
-                ins.v1 = atoll(s);  // leave r1 = -1
-            }
-        }
-        ++field;
-        s = strtok(NULL, " ");
-    }
-    return ins;
-}
-
-// Init & load program p
-static void load(pProg p)
-{
-    // Runtime
-    p->ip     = 0;
-    p->tick   = 0;
-
-    // Registers
-    for (size_t i = 0; i < REGSIZE; ++i) {
-        p->reg[i] = 0;
-    }
-
-    // Program
-    FILE *f = fopen("../aocinput/2017-23-input.txt", "r");
-    if (f == NULL) {
-        fprintf(stderr, "File not found");
-        exit(1);
-    }
-    char *buf = NULL;
-    size_t buflen = 0, line = 0;
-    ssize_t len;
-    while ((len = getline(&buf, &buflen, f)) != -1 && line < MEMSIZE) {
-        p->mem[line++] = assemble(buf);
-    }
-    fclose(f);
-    free(buf);
-}
-
-static void print(pProg p, bool listing)
-{
-    int i;
-    int64_t k;
-
-    // Runtime parameters
-    printf("IP   : %i\n", p->ip);
-    printf("Tick : %"PRId64"\n", p->tick);
-    for (i = 0; i < REGSIZE; ++i) {
-        if ((k = p->reg[i]) != 0) {
-            printf("Rg %c : %"PRId64"\n", REGBASE + i, k);
-        }
-    }
-
-    // Program listing
-    if (listing) {
-        for (i = 0; i < MEMSIZE; ++i) {
-            size_t j = id2index(p->mem[i].op);
-            printf("  %2i: %s", i, cmd[j].name);
-            if (p->mem[i].r0 != -1) {
-                printf(" %c", REGBASE + p->mem[i].r0);
-            } else {
-                printf(" %"PRId64, p->mem[i].v0);
-            }
-            printf("\n");
-        }
-    }
-    printf("\n");
-}
-
-// Run program p, use program q as message queue
-static int64_t run(pProg p)
+int main(void)
 {
-    int64_t mulcount = 0;
-    while (p->ip >= 0 && p->ip < MEMSIZE) {
-        pInstr i = &(p->mem[p->ip]);
-        if (i->r0 != -1) {
-            i->v0 = p->reg[i->r0];
-        }
-        if (i->r1 != -1) {
-            i->v1 = p->reg[i->r1];
-        }
-        switch (i->op) {
-        case SET:
-            p->reg[i->r0] = i->v1;
-            break;
-        case SUB:
-            p->reg[i->r0] -= i->v1;
-            break;
-        case MUL:
-            p->reg[i->r0] *= i->v1;
-            ++mulcount;
-            break;
-        case JNZ:
-            if (i->v0 != 0) {
-                p->ip += i->v1;
-                p->tick++;
-                continue;  // skip updates at end of loop
-            }
-            break;
-        case JMP:
-            p->ip += i->v1;
-            p->tick++;
-            continue;  // skip updates at end of loop
-        case NOP:
-            break;
-        }
-        p->ip++;
-        p->tick++;
+    if (!rv_load(&m, &rv_duet, FNAME, false)) {
+        fprintf(stderr, "File not found or syntax error: "FNAME"\n");
+        return 1;
     }
-    return mulcount;
-}
 
-int main(void)
-{
-    Prog p;
+#ifdef TIMER
+    starttimer();
+#endif
 
     // Part 1
-    load(&p);
-    printf("%"PRId64"\n", run(&p));  // 3969
-
-    // Part 2
-    const int magic = 65;
-    const int start = magic * 100 + 100000;
-    const int stop = start + 17000;
+    int64_t mulcount = 0;
+    m.trace = countmul;
+    m.arg = &mulcount;
+    rv_reset(&m);
+    rv_run(&m);
+    printf("%"PRId64"\n", mulcount);  // 3969
+
+    // Part 2: reverse engineered, program counts composite numbers in b..c
+    // with step size from the second to last line "sub b -17"
+    m.trace = NULL;
+    rv_break(&m, LOOPSTART, setup);
+    rv_reset(&m);
+    m.reg[0] = 1;
+    rv_run(&m);
+    const int start = (int)m.reg[1];
+    const int stop = (int)m.reg[2];
+    const int step = (int)-m.src[m.size - 2].arg[1].imm;
     int composite = 0;
-    for (int n = start; n <= stop; n += 17) {
+    for (int n = start; n <= stop; n += step) {
         if (!(n & 1)) {
             composite++;
             continue;
@@ -234,5 +89,8 @@ int main(void)
     }
     printf("%d\n", composite);  // 917
 
-    return 0;
+#ifdef TIMER
+    printf("Time: %.0f us\n", stoptimer_us());
+#endif
+    rv_free(&m);
 }
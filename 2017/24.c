@@ -5,22 +5,31 @@
  * By: E. Dronkert https://github.com/ednl
  *
  * Compile:
- *     cc -std=c17 -Wall -Wextra -pedantic 24.c
+ *     cc -std=gnu17 -Wall -Wextra -pedantic ../cores.c 24.c -lpthread
  * Enable timer:
- *     cc -std=gnu17 -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c 24.c
+ *     cc -std=gnu17 -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c ../cores.c 24.c -lpthread
  * Get minimum runtime from timer output:
  *     m=99999999;for((i=0;i<20000;++i));do t=$(./a.out|tail -n1|awk '{print $2}');((t<m))&&m=$t&&echo "$m ($i)";done
  * Minimum runtime measurements:
- *     Macbook Pro 2024 (M4 4.4 GHz) :  46 ms
- *     Mac Mini 2020 (M1 3.2 GHz)    :  68 ms
- *     Raspberry Pi 5 (2.4 GHz)      : 118 ms
+ *     Macbook Pro 2024 (M4 4.4 GHz) : ? ms
+ *     Mac Mini 2020 (M1 3.2 GHz)    : ? ms
+ *     Raspberry Pi 5 (2.4 GHz)      : ? ms
+ *
+ * Components are bits in a 64-bit set, and every port has the set of
+ * components that fit it. The best way to extend a bridge only depends on
+ * the open port and the set of components already used, so that result is
+ * memoised per (port, used). A double component (same port on both sides)
+ * is always taken as soon as it fits: it adds strength and length without
+ * changing the open port. Each component that fits port 0 starts a branch;
+ * the branches are spread over threads, every thread with its own memo.
  */
 
 #include <stdio.h>
-#include <stdlib.h>
+#include <stdlib.h>   // calloc, free
 #include <stdint.h>
-#include <inttypes.h>
 #include <stdbool.h>
+#include <pthread.h>  // pthread_create, pthread_join
+#include "../cores.h"
 #ifdef TIMER
     #include "../startstoptimer.h"
 #endif
@@ -28,20 +37,45 @@
 #define DEBUG
 #define FNAME "../aocinput/2017-24-input.txt"
 #define N 57  // number of lines in input file
+#define PORTS 64  // max port value + 1, must fit in PORTBITS
+#define PORTBITS 6
+#ifndef MEMOBITS
+    #define MEMOBITS 15  // memo entries per thread = 2^MEMOBITS, more is not faster for 57 components
+#endif
+#define PROBES 8  // max slots to look at in memo before giving up
+#define MAXTHREADS 64  // arbitrary limit to avoid dynamic allocation of thread arrays
+
+_Static_assert(N + PORTBITS <= 64, "memo key is used set + port in 64 bits");
+
+typedef uint64_t Set;  // bit i = component i
 
-// Components with two ports, sum of ports, used flag
+// Components with two ports, sum of ports
 typedef struct comp {
     int port1, port2, strength;
-    bool used;
 } Comp;
 
+// Best extension of a bridge: part 1 max strength; part 2 max length, then max strength
+typedef struct ext {
+    int sum, len, sum2;
+} Ext;
+
+typedef struct memo {
+    Set key;  // used << PORTBITS | port, 0 = empty (used is never empty)
+    Ext ext;
+} Memo;
+
+typedef struct work {
+    Set start;   // top-level branches for this thread
+    Memo *memo;  // 2^MEMOBITS entries
+    Ext best;
+} Work;
+
 #ifdef DEBUG
 static int exist[51][51];
 #endif
 static Comp comp[N] = {0};
-static int maxsum = 0;
-static int maxlen = 0;
-static int maxsum2 = 0;
+static Set fits[PORTS];  // components with this port
+static Set doubles;      // components with the same port twice
 
 static int load(void)
 {
@@ -52,11 +86,22 @@ static int load(void)
     }
     int n = 0;
     for (int a, b; n < N && fscanf(f, "%d/%d ", &a, &b) == 2; ++n) {
-        comp[n] = (Comp){a, b, a + b, false};
+        if (a < 0 || b < 0 || a >= PORTS || b >= PORTS) {
+            fprintf(stderr, "Port out of range: %d/%d\n", a, b);
+            fclose(f);
+            return 0;
+        }
+        comp[n] = (Comp){a, b, a + b};
+        fits[a] |= (Set)1 << n;
+        fits[b] |= (Set)1 << n;
+        if (a == b)
+            doubles |= (Set)1 << n;
     #ifdef DEBUG
-        exist[a][b]++;
-        if (a != b)
-            exist[b][a]++;
+        if (a < 51 && b < 51) {
+            exist[a][b]++;
+            if (a != b)
+                exist[b][a]++;
+        }
     #endif
     }
     fclose(f);
@@ -83,28 +128,66 @@ static int load(void)
     return n;
 }
 
-static void bridge(int port, int len, int sum)
+// Keep the best of both parts
+static void better(Ext *const best, const Ext e)
+{
+    if (e.sum > best->sum)
+        best->sum = e.sum;
+    if (e.len > best->len || (e.len == best->len && e.sum2 > best->sum2)) {
+        best->len = e.len;
+        best->sum2 = e.sum2;
+    }
+}
+
+// Component i in front of extension e
+static Ext prepend(const int i, const Ext e)
+{
+    const int s = comp[i].strength;
+    return (Ext){e.sum + s, e.len + 1, e.sum2 + s};
+}
+
+// Best extension from open port with components in 'used' already taken
+static Ext bridge(Memo *const memo, const int port, const Set used)
 {
-    // Part 1
-    if (sum > maxsum)
-        maxsum = sum;
-
-    // Part 2
-    if (len > maxlen) {
-        maxlen = len;
-        maxsum2 = sum;
-    } else if (len == maxlen && sum > maxsum2)
-        maxsum2 = sum;
-
-    for (int i = 0; i < N; ++i)
-        if (!comp[i].used && (port == comp[i].port1 || port == comp[i].port2)) {
-            comp[i].used = true;
-            bridge(
-                port == comp[i].port1 ? comp[i].port2 : comp[i].port1,
-                len + 1,
-                sum + comp[i].strength);
-            comp[i].used = false;
+    const Set key = used << PORTBITS | (Set)port;
+    const uint64_t h = key * 0x9e3779b97f4a7c15;  // Fibonacci hash
+    Memo *slot = NULL;
+    for (int p = 0; p < PROBES; ++p) {
+        Memo *const m = &memo[((h >> (64 - MEMOBITS)) + (uint64_t)p) & ((1 << MEMOBITS) - 1)];
+        if (m->key == key)
+            return m->ext;
+        if (!m->key) {
+            slot = m;
+            break;
         }
+    }
+
+    Ext best = {0};
+    Set next = fits[port] & ~used;
+    const Set dbl = next & doubles;
+    if (dbl)
+        next = dbl & -dbl;  // one double now, any others later
+    for (; next; next &= next - 1) {
+        const int i = __builtin_ctzll(next);
+        const int to = comp[i].port1 == port ? comp[i].port2 : comp[i].port1;
+        better(&best, prepend(i, bridge(memo, to, used | (Set)1 << i)));
+    }
+
+    if (slot)  // else: memo full around here, just don't store
+        *slot = (Memo){key, best};
+    return best;
+}
+
+// Parallel execution in separate threads: best of some top-level branches.
+static void *branches(void *arg)
+{
+    Work *const w = arg;
+    for (Set next = w->start; next; next &= next - 1) {
+        const int i = __builtin_ctzll(next);
+        const int to = comp[i].port1 ? comp[i].port1 : comp[i].port2;
+        better(&w->best, prepend(i, bridge(w->memo, to, (Set)1 << i)));
+    }
+    return NULL;
 }
 
 int main(void)
@@ -116,8 +199,36 @@ int main(void)
     starttimer();
 #endif
 
-    bridge(0, 0, 0);
-    printf("%d %d\n", maxsum, maxsum2);   // 1868 1841
+    // Deal the branches from port 0 round-robin to the threads
+    Set start = fits[0];
+    const Set dbl = start & doubles;
+    if (dbl)
+        start = dbl & -dbl;  // 0/0 is a double too
+    const int branchcount = __builtin_popcountll(start);
+    const int threads = branchcount < 1 ? 1 : coresavail(1, branchcount < MAXTHREADS ? branchcount : MAXTHREADS);
+    Work work[MAXTHREADS] = {0};
+    for (int t = 0; start; start &= start - 1, t = (t + 1) % threads)
+        work[t].start |= start & -start;
+    for (int t = 0; t < threads; ++t)
+        if (!(work[t].memo = calloc((size_t)1 << MEMOBITS, sizeof *work[t].memo)))
+            return 2;
+
+    if (threads == 1)
+        branches(&work[0]);
+    else {
+        pthread_t tid[MAXTHREADS];
+        for (int t = 0; t < threads; ++t)
+            pthread_create(&tid[t], NULL, branches, &work[t]);
+        for (int t = 0; t < threads; ++t)
+            pthread_join(tid[t], NULL);
+    }
+
+    Ext best = {0};
+    for (int t = 0; t < threads; ++t) {
+        better(&best, work[t].best);
+        free(work[t].memo);
+    }
+    printf("%d %d\n", best.sum, best.sum2);   // 1868 1841
 
 #ifdef TIMER
     printf("Time: %.0f ms\n", stoptimer_ms());
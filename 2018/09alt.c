@@ -8,24 +8,115 @@
  *     cc -std=c17 -Wall -Wextra -pedantic 09alt.c
  * Enable timer:
  *     cc -std=gnu17 -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c 09alt.c
+ * Bigger game, e.g. up to a billion marbles for part 2:
+ *     cc -std=gnu17 -O3 -march=native -mtune=native -DTIMER -DFACTOR=14000 ../startstoptimer.c 09alt.c
  * Get minimum runtime from timer output:
  *     m=99999999;for((i=0;i<20000;++i));do t=$(./a.out|tail -n1|awk '{print $2}');((t<m))&&m=$t&&echo "$m ($i)";done
  * Minimum runtime measurements:
- *     Macbook Pro 2024 (M4 4.4 GHz) :  3.12 ms
- *     Mac Mini 2020 (M1 3.2 GHz)    :  4.89 ms
+ *     Macbook Pro 2024 (M4 4.4 GHz) :  ?    ms
+ *     Mac Mini 2020 (M1 3.2 GHz)    :  ?    ms
  *     Raspberry Pi 5 (2.4 GHz)      :  ?    ms
+ *
+ * The circle is unrolled into a line that is read at one end (i) and
+ * written at the other (j), following the 23-step pattern of the game.
+ * Everything before i is never needed again, and nothing from the final
+ * read position onwards is ever read. So the line is a deque of fixed
+ * size blocks: a block is allocated when the writer enters it, and freed
+ * when the reader leaves it; writes past the last read position go
+ * nowhere. Memory is proportional to the live part of the circle, not to
+ * the number of marbles. Each block is 16 kB, and the scores of all
+ * players together are small, so the hot data stays in cache.
 */
 
 #include <stdio.h>
-#include <stdlib.h>  // calloc, free
+#include <stdlib.h>  // malloc, calloc, free
 #ifdef TIMER
     #include "../startstoptimer.h"
 #endif
 
 #define FNAME "../aocinput/2018-09-input.txt"
 #define KEEP 23U  // puzzle rule
+#define BLOCK 4096U  // marbles per deque block
+#define MAXMARBLE 4000000000ULL  // marble numbers must fit in u32
+#ifndef FACTOR
+    #define FACTOR 100U  // part 2
+#endif
 
 typedef unsigned int u32;
+typedef unsigned long long u64;
+
+// Line of marbles, only the blocks between reader and writer exist
+typedef struct deque {
+    u32 **blk;    // block table
+    u64 blocks;   // size of block table
+    u64 limit;    // line index of first marble that is never read
+    u32 *sink;    // block for writes from limit onwards
+} Deque;
+
+// Reader or writer position in the deque
+typedef struct cursor {
+    u32 *p, *end;  // current marble, end of current block
+    u64 next;      // index of next block
+} Cursor;
+
+static Deque dq;
+
+// Writer: go to next block, allocate it if it will be read
+static void nextwrite(Cursor *const c)
+{
+    if (c->next * BLOCK < dq.limit) {
+        u32 *b = dq.blk[c->next] = malloc(BLOCK * sizeof *b);
+        if (!b) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        c->p = b;
+    } else
+        c->p = dq.sink;
+    c->end = c->p + BLOCK;
+    c->next++;
+}
+
+// Reader: free block that was read, go to next block
+static void nextread(Cursor *const c)
+{
+    free(dq.blk[c->next - 1]);
+    dq.blk[c->next - 1] = NULL;
+    c->p = dq.blk[c->next];
+    c->end = c->p + BLOCK;
+    c->next++;
+}
+
+static inline void put(Cursor *const w, const u32 val)
+{
+    if (w->p == w->end)
+        nextwrite(w);
+    *w->p++ = val;
+}
+
+// Current marble of the reader (without advancing)
+static inline u32 *peek(Cursor *const r)
+{
+    if (r->p == r->end)
+        nextread(r);
+    return r->p;
+}
+
+static inline u32 get(Cursor *const r)
+{
+    if (r->p == r->end)
+        nextread(r);
+    return *r->p++;
+}
+
+static u64 highscore(const u64 *const score, const u32 players)
+{
+    u64 hi = 0;
+    for (u32 t = 0; t != players; ++t)
+        if (score[t] > hi)
+            hi = score[t];
+    return hi;
+}
 
 int main(void)
 {
@@ -39,82 +130,71 @@ int main(void)
 
     const u32 players = inp1;
     const u32 marbles1 = inp2;
-    const u32 marbles2 = marbles1 * 100U;  // part 2
-    const u32 len = marbles2 * 37U / 23U;  // needed for my input: 11586785
-
-    u32 *score = calloc(players, sizeof *score);
-    u32 *line = calloc(len, sizeof *line);
+    if ((u64)marbles1 * FACTOR > MAXMARBLE || !players)
+        return 3;
+    const u32 marbles2 = marbles1 * FACTOR;  // part 2
+
+    // Reader moves 16 places per 23 marbles, after 6 at the start
+    dq.limit = 6U + (u64)(marbles2 / KEEP) * 16U;
+    dq.blocks = dq.limit / BLOCK + 2;
+    dq.blk = calloc(dq.blocks, sizeof *dq.blk);
+    dq.sink = malloc(BLOCK * sizeof *dq.sink);
+    u64 *score = calloc(players, sizeof *score);
+    if (!dq.blk || !dq.sink || !score)
+        return 4;
 
 #ifdef TIMER
     starttimer();
 #endif
 
-    u32 i = 0, j = 1, n = 1, m = KEEP + 1, k = KEEP, hi = 0;
-
-    for (u32 t = 0; t != 6U; ++t) {
-        line[j++] = line[i++];      // skip one
-        line[j++] = n++;            // 1-6
-    }
-
-    for (; k <= marbles1; k += KEEP) {
-        for (u32 t = 0; t != 12U; ++t) {
-            line[j++] = line[i++];  // skip one
-            line[j++] = n++;        // 7-18
-        }
+    Cursor r = {0}, w = {0};
+    nextwrite(&w);
+    r.p = w.p;
+    r.end = w.end;
+    r.next = w.next;
+    put(&w, 0);
 
-        // Keep multiple of 23 + take marble at index i
-        score[k % players] += k + line[i];
+    u32 n = 1, m = KEEP + 1, k = KEEP;
 
-        line[i] = n++;              // 19
-        line[j++] = line[i++];      // skip one
-
-        for (u32 t = 0; t != 3U; ++t) {
-            line[j++] = line[i++];  // skip one
-            line[j++] = m++;        // 24, 26, 28
-            line[j++] = n++;        // 20, 21, 22
-            line[j++] = m++;        // 25, 27, 29
-        }
-
-        n += KEEP - 16U;  // 16 already counted, need 7 more to make 23
-        m += KEEP - 6U;   // 6 already counted, need 17 more to make 23
+    for (u32 t = 0; t != 6U; ++t) {
+        put(&w, get(&r));       // skip one
+        put(&w, n++);           // 1-6
     }
 
-    for (u32 t = 0; t != players; ++t)
-        if (score[t] > hi)
-            hi = score[t];
-    printf("Part 1: %u\n", hi);  // 390093
-
-    for (; k <= marbles2; k += KEEP) {
-        for (u32 t = 0; t < 12U; ++t) {
-            line[j++] = line[i++];  // skip one
-            line[j++] = n++;        // 7-18
+    for (int part = 1; part <= 2; ++part) {
+        const u32 marbles = part == 1 ? marbles1 : marbles2;
+        for (; k <= marbles; k += KEEP) {
+            for (u32 t = 0; t != 12U; ++t) {
+                put(&w, get(&r));   // skip one
+                put(&w, n++);       // 7-18
+            }
+
+            // Keep multiple of 23 + take marble at reader
+            u32 *const cur = peek(&r);
+            score[k % players] += k + *cur;
+
+            *cur = n++;             // 19
+            put(&w, get(&r));       // skip one
+
+            for (u32 t = 0; t != 3U; ++t) {
+                put(&w, get(&r));   // skip one
+                put(&w, m++);       // 24, 26, 28
+                put(&w, n++);       // 20, 21, 22
+                put(&w, m++);       // 25, 27, 29
+            }
+
+            n += KEEP - 16U;  // 16 already counted, need 7 more to make 23
+            m += KEEP - 6U;   // 6 already counted, need 17 more to make 23
         }
-
-        // Keep multiple of 23 + take marble at index i
-        score[k % players] += k + line[i];
-
-        line[i] = n++;              // 19
-        line[j++] = line[i++];      // skip one
-
-        for (u32 t = 0; t < 3U; ++t) {
-            line[j++] = line[i++];  // skip one
-            line[j++] = m++;        // 24, 26, 28
-            line[j++] = n++;        // 20, 21, 22
-            line[j++] = m++;        // 25, 27, 29
-        }
-
-        n += KEEP - 16U;  // 16 already counted, need 7 more to make 23
-        m += KEEP - 6U;   // 6 already counted, need 17 more to make 23
+        printf("Part %d: %llu\n", part, highscore(score, players));  // 390093 3150377341
     }
 
-    for (u32 t = 0; t < players; ++t)
-        if (score[t] > hi)
-            hi = score[t];
-    printf("Part 2: %u\n", hi);  // 3150377341
-
 #ifdef TIMER
     printf("Time: %.0f us\n", stoptimer_us());
 #endif
-    free(line);
+    for (u64 i = 0; i < dq.blocks; ++i)
+        free(dq.blk[i]);
+    free(dq.blk);
+    free(dq.sink);
     free(score);
 }
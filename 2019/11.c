@@ -10,311 +10,115 @@
 
 ////////// Includes & Defines /////////////////////////////////////////////////
 
-#ifdef __STDC_ALLOC_LIB__
-#define __STDC_WANT_LIB_EXT2__ 1
-#else
-#define _POSIX_C_SOURCE 200809L
-#endif
-
-#include <stdio.h>   // fopen, fgetc, getdelim, printf
-#include <stdlib.h>  // atoi, atol
-
-#define DEBUG
-#define PAD 1000  // storage space to add at end of program
-#define RESUME 0
-#define RESET  1
-
-#define ERR_OK               0
-#define ERR_OPCODE_UNKNOWN   1
-#define ERR_OPCODE_UNDEFINED 2
-#define ERR_SEGFAULT_PARAM   3
-#define ERR_SEGFAULT_READ    4
-#define ERR_SEGFAULT_WRITE   5
-
-// Opcodes
-#define ADD  1L  // add
-#define MUL  2L  // multiply
-#define IN   3L  // get input
-#define OUT  4L  // send output
-#define JNZ  5L  // jump non-zero
-#define JZ   6L  // jump zero
-#define LT   7L  // compare less than
-#define EQ   8L  // compare equal
-#define RBO  9L  // relative base offset
-#define HLT 99L  // return (halt)
-
-// Parameters
-#define POS  0L  // positional
-#define IMM  1L  // immediate
-#define OFF  2L  // offset
-#define ARG  3L  // max number of parameters per opcode
+#include <stdio.h>     // printf, putchar
+#include <stdlib.h>    // free
+#include <string.h>    // memset
+#include "intcode.h"  // compile: cc intcode.c 11.c
 
 #define RADIUS 100
+#define DIM (RADIUS * 2 + 1)
+
+#define UNPAINTED (-1)
+#define BLACK 0
+#define WHITE 1
 
 ////////// Typedefs & Constants ///////////////////////////////////////////////
 
 // Location of program on disk
 static const char *inp = "../aocinput/2019-11-input.txt";
 
-// Language entries
-typedef struct Lang {
-    long op;
-    int rp, wp;
-} LANG;
-
-// Language definition: { opcode, read count, write count }
-// Every read parameter can be positional or immediate
-// Write parameters are always positional
-static const LANG lang[] = {
-    { ADD, 2, 1 },
-    { MUL, 2, 1 },
-    { IN , 0, 1 },
-    { OUT, 1, 0 },
-    { JNZ, 2, 0 },
-    { JZ , 2, 0 },
-    { LT , 2, 1 },
-    { EQ , 2, 1 },
-    { RBO, 1, 0 },
-    { HLT, 0, 0 }
-};
-static const int langsize = sizeof lang / sizeof *lang;
+// Robot position and direction, next output is colour or turn
+typedef struct Robot {
+    int x, y, dx, dy;
+    int turn;
+} ROBOT;
 
 ////////// Globals ////////////////////////////////////////////////////////////
 
-static long *dat = NULL, *mem = NULL;
-static int datsize = 0, memsize = 0;
-
-static int panel[RADIUS * 2 + 1];
-
-////////// Function Declarations //////////////////////////////////////////////
-
-void output(long);
-long input(void);
-int sizecsv(void);
-int readcsv(void);
-void copyprog(void);
-int execprog(int);
-void paint(long col, long dir);
+static signed char panel[DIM][DIM];
 
 ////////// Function Definitions ///////////////////////////////////////////////
 
-// Process value for output
-// Arg: val = output value
-void output(long val)
-{
-    printf("%ld\n", val);
-}
-
-// Request value for input
-// Ret: input value
-long input(void)
-{
-    char *s = NULL;
-    size_t t = 0;
-    long val = -1;
-
-    printf("? ");
-    if (getline(&s, &t, stdin) > 0)
-        val = atol(s);
-    free(s);
-    return val;
-}
-
-// Count values in a one-line CSV file by counting commas + 1
-int sizecsv(void)
-{
-    FILE *fp;
-    int ch, i = 0;
-
-    if ((fp = fopen(inp, "r")) != NULL)
-    {
-        i = 1;
-        while ((ch = fgetc(fp)) != EOF)
-            if (ch == ',')
-                ++i;
-        fclose(fp);
-    }
-    return i;
-}
-
-// Read long integer CSV values from file to array dat
-// Pre: dat must be allocated to size datsize > 0
-//      inp must contain name of readable file
-// Ret: number of values read
-int readcsv(void)
-{
-    FILE *fp;        // file pointer
-    char *s = NULL;  // dynamically allocated buffer
-    size_t t = 0;    // size of buffer
-    int i = 0;       // values read
-
-    if (dat != NULL && datsize > 0 && (fp = fopen(inp, "r")) != NULL)
-    {
-        while (i < datsize && getdelim(&s, &t, ',', fp) > 0)
-            dat[i++] = atol(s);
-        free(s);
-        fclose(fp);
-    }
-    return i;
-}
-
-// Copy program from dat to mem and zero the padding
-// Pre: dat must be allocated to size datsize > 0
-//      mem must be allocated to size memsize >= datsize
-void copyprog(void)
+// Camera: colour of panel under the robot
+static VMType input(void *arg)
 {
-    long *src, *dst;
-    int i;
-
-    if (dat != NULL && mem != NULL && datsize > 0 && datsize <= memsize)
-    {
-        src = dat;
-        dst = mem;
-        i = datsize;
-        while (i--)
-            *dst++ = *src++;
-        i = memsize - datsize;
-        while (i--)
-            *dst++ = 0;
-    }
+    const ROBOT *r = arg;
+    return panel[r->y][r->x] == WHITE;
 }
 
-// Parse and execute all instructions in memory
-int execprog(int reset)
+// Output alternates between colour to paint, and turn (0=left, 1=right) + move
+static void output(VMType val, void *arg)
 {
-    static long base = 0;
-    static int pc = 0;
-
-    int i, j, k, retval = ERR_OK;
-    long in, op, par[ARG], parmode;
-
-    long vec[2];
-    int ivec = 0;
-
-    if (reset)
-    {
-        copyprog();
-        base = 0;
-        pc = 0;
-    }
-
-    while (pc >= 0 && pc < memsize)
-    {
-        // Get opcode and parameter modes from instruction
-        in = mem[pc++];                // get instruction, increment program counter
-        op = in % 100;                 // opcode part of instruction
-        in /= 100;                     // this leaves parameter modes
-
-        // Look up opcode, halt if not found or too long
-        i = 0;
-        while (i < langsize && op != lang[i].op)
-            ++i;
-        if (i == langsize)             // not in the language def?
-        {
-            #ifdef DEBUG
-            printf("Unknown opcode %ld at %d\n", op, pc - 1);
-            #endif
-            return ERR_OPCODE_UNKNOWN;
+    ROBOT *r = arg;
+    if (!r->turn)
+        panel[r->y][r->x] = (signed char)val;
+    else {
+        const int t = r->dx;
+        if (val) {  // turn right (y down)
+            r->dx = -r->dy;
+            r->dy = t;
+        } else {  // turn left
+            r->dx = r->dy;
+            r->dy = -t;
         }
-        if (pc + lang[i].rp + lang[i].wp > memsize)
-        {
-            #ifdef DEBUG
-            printf("Too many parameters for program size at %d\n", pc - 1);
-            #endif
-            return ERR_SEGFAULT_PARAM;
-        }
-
-        // Get read parameter(s)
-        for (j = 0; j < lang[i].rp; ++j)
-        {
-            par[j] = mem[pc++];        // get immediate value param, increment program counter
-            parmode = in % 10;
-            in /= 10;                  // next parameter mode
-            if (parmode != IMM)        // mode = positional or offset parameter?
-            {
-                if (parmode == OFF)
-                    par[j] += base;
-                if (par[j] < 0 || par[j] >= memsize)
-                {
-                    #ifdef DEBUG
-                    printf("Read beyond program size: %ld\n", par[j] - memsize + 1);
-                    #endif
-                    return ERR_SEGFAULT_READ;
-                }
-                par[j] = mem[par[j]];  // get positional value
-            }
-        }
-
-        // Get write parameter (always positional/offset but keep the address this time)
-        if (lang[i].wp)
-        {
-            par[j] = mem[pc++];        // get address param, increment program counter
-            if (in % 10 == OFF)        // mode = offset parameter?
-                par[j] += base;
-            if (par[j] < 0 || par[j] >= memsize)
-            {
-                #ifdef DEBUG
-                printf("Write beyond program size: %ld\n", par[j] - memsize + 1);
-                #endif
-                return ERR_SEGFAULT_WRITE;
-            }
-        }
-
-        // Execute
-        switch (op)
-        {
-            case ADD: mem[par[2]] = par[0] + par[1];  break;
-            case MUL: mem[par[2]] = par[0] * par[1];  break;
-            case IN : mem[par[0]] = k; break;
-            case OUT:
-                vec[ivec++] = par[0];
-                if (ivec == 3)
-                {
-                    drawtile(vec[0], vec[1], vec[2]);
-                    ivec = 0;
-                }
-                break;
-            case JNZ: if ( par[0]) pc = par[1];       break;
-            case JZ : if (!par[0]) pc = par[1];       break;
-            case LT : mem[par[2]] = par[0] < par[1];  break;
-            case EQ : mem[par[2]] = par[0] == par[1]; break;
-            case RBO: base += par[0];                 break;
-            case HLT: return retval;
-            default :
-                #ifdef DEBUG
-                printf("Internal error: undefined opcode %ld\n", op);
-                #endif
-                return ERR_OPCODE_UNDEFINED;
+        r->x += r->dx;
+        r->y += r->dy;
+        if (r->x < 0 || r->x >= DIM || r->y < 0 || r->y >= DIM) {
+            r->x = r->y = RADIUS;  // out of range, shouldn't happen
+            printf("Robot left the hull\n");
         }
     }
-    return retval;
+    r->turn ^= 1;
 }
 
-// Draw tiles on screen
-// Arg: x=-1..41, y=0..23, t=0..4
-void paint(long col, long dir)
+// Run robot on fresh hull with starting panel colour
+static void paint(VM *vm, const VMType *dat, int len, int start)
 {
+    ROBOT robot = {RADIUS, RADIUS, 0, -1, 0};  // facing up
+
+    memset(panel, UNPAINTED, sizeof panel);
+    panel[RADIUS][RADIUS] = (signed char)start;
+    if (vm_init(vm, dat, len, 0))
+        vm_exec(vm, input, output, &robot);
 }
 
 ////////// Main ///////////////////////////////////////////////////////////////
 
 int main(void)
 {
-    int i, len, ret;
+    static VM vm;
+    int len, i, j, count = 0;
+    int x0 = DIM, x1 = -1, y0 = DIM, y1 = -1;
+    VMType *dat = vm_load(inp, &len);
 
-    if ((len = sizecsv()) > 0)
+    if (dat)
     {
-        datsize = len;
-        memsize = len + PAD;
-        dat = malloc(datsize * sizeof *dat);
-        mem = malloc(memsize * sizeof *mem);
-        if (dat != NULL && mem != NULL && readcsv() == len)
+        // Part one: number of panels painted at least once
+        paint(&vm, dat, len, BLACK);
+        for (i = 0; i < DIM; ++i)
+            for (j = 0; j < DIM; ++j)
+                count += panel[i][j] != UNPAINTED;
+        printf("%d\n", count);
+
+        // Part two: registration identifier
+        paint(&vm, dat, len, WHITE);
+        for (i = 0; i < DIM; ++i)
+            for (j = 0; j < DIM; ++j)
+                if (panel[i][j] == WHITE)
+                {
+                    if (i < y0) y0 = i;
+                    if (i > y1) y1 = i;
+                    if (j < x0) x0 = j;
+                    if (j > x1) x1 = j;
+                }
+        for (i = y0; i <= y1; ++i)
         {
-            ret = execprog(RESET);
-            printf("ret = %d\n", ret);
+            for (j = x0; j <= x1; ++j)
+                putchar(panel[i][j] == WHITE ? '#' : ' ');
+            putchar('\n');
         }
-        free(mem);
-        free(dat);
     }
+    vm_free(&vm);
+    free(dat);
     return 0;
 }
@@ -22,85 +22,37 @@
 #include <inttypes.h>  // PRId64 = ld on PC/Mac, lld on RPi
 #include <ctype.h>     // isdigit
 #include <string.h>    // strcpy
+#include "intcode.h"  // compile: cc intcode.c 25.c
+#ifdef AOT
+#include "intcode_aot.h"  // native code: cc -DAOT intcode.c intcode_aot.c 25.c -ldl
+#endif
 
 #define DEBUG
 
 // Virtual machine operation
 #define VM_FNLEN  32  // max file name length of program on disk
-#define VM_GROW 1000  // storage space to add when requested
-#define VM_RESUME  0
-#define VM_RESET   1
 
 // Error codes
-#define ERR_OK               0
-#define ERR_OPCODE_UNKNOWN   1
-#define ERR_OPCODE_UNDEFINED 2
-#define ERR_SEGFAULT_PARAM   3
-#define ERR_SEGFAULT_READ    4
-#define ERR_SEGFAULT_WRITE   5
-#define ERR_SEGFAULT_OTHER   6
-#define ERR_OUTOFMEMORY      7
-
-// CPU opcodes
-#define CPU_ADD  1L  // add
-#define CPU_MUL  2L  // multiply
-#define CPU_IN   3L  // get input
-#define CPU_OUT  4L  // send output
-#define CPU_JNZ  5L  // jump non-zero
-#define CPU_JZ   6L  // jump zero
-#define CPU_LT   7L  // compare less than
-#define CPU_EQ   8L  // compare equal
-#define CPU_RBO  9L  // relative base offset
-#define CPU_HLT 99L  // return (halt)
-
-// Opcode parameters
-#define PAR_POS 0L  // positional
-#define PAR_IMM 1L  // immediate
-#define PAR_OFF 2L  // offset
-#define PAR_MAX 3L  // max number of parameters per opcode
-
-////////// Typedefs & Constants ///////////////////////////////////////////////
-
-// Language entries (instruction definition)
-typedef struct Instr {
-    int opcode;
-    int read, write;
-} INSTR;
-
-// Language definition: { opcode, read par count, write par count }
-// Every read parameter can be positional or immediate
-// Write parameters are always positional
-static const INSTR cpu[] = {
-    { CPU_ADD, 2, 1 },
-    { CPU_MUL, 2, 1 },
-    { CPU_IN , 0, 1 },
-    { CPU_OUT, 1, 0 },
-    { CPU_JNZ, 2, 0 },
-    { CPU_JZ , 2, 0 },
-    { CPU_LT , 2, 1 },
-    { CPU_EQ , 2, 1 },
-    { CPU_RBO, 1, 0 },
-    { CPU_HLT, 0, 0 }
-};
-static const int cpusize = sizeof cpu / sizeof *cpu;
+#define ERR_OK 0
 
 ////////// Globals ////////////////////////////////////////////////////////////
 
 // Virtual machine
 static char vm_filename[VM_FNLEN + 1];
-static int64_t *vm_cache = NULL, *vm_memory = NULL;
-static int vm_cachesize = 0, vm_memorysize = 0;
+static VM vm;
+static VMType *vm_cache = NULL;
+static int vm_cachesize = 0;
+#ifdef AOT
+static VMAot aot;  // falls back to interpreter if translation fails
+#endif
 
 ////////// Function Declarations //////////////////////////////////////////////
 
 int aoc_thispuzzle(char **);
 void aoc_setfilename(int);
-int aoc_csvfields(void);
-int aoc_csv2cache(void);
-void vm_refresh(void);
-int vm_exec(int);
-int64_t vm_input(void);
-void vm_output(int64_t);
+int vm_restart(void);
+VMType vm_input(void *);
+void vm_output(VMType, void *);
 
 ////////// Function Definitions ///////////////////////////////////////////////
 
@@ -129,198 +81,19 @@ void aoc_setfilename(int num)
         strcpy(vm_filename, test);
 }
 
-// Count values in a one-line CSV file by counting commas + 1
-int aoc_csvfields(void)
-{
-    FILE *fp;
-    int c, i = 0;
-
-    if ((fp = fopen(vm_filename, "r")) != NULL)
-    {
-        i = 1;
-        while ((c = fgetc(fp)) != EOF)
-            if (c == ',')
-                ++i;
-        fclose(fp);
-    }
-    return i;
-}
-
-// Read 64-bit integer CSV values from file to cache
-// Pre: vm_cache must be allocated to size vm_cachesize > 0
-//      vm_filename must contain name of readable file
-// Ret: number of values read
-int aoc_csv2cache(void)
-{
-    FILE *fp;        // file pointer
-    char *s = NULL;  // dynamically allocated buffer
-    size_t t = 0;    // size of buffer
-    int i = 0;       // values read
-
-    if (vm_cache != NULL && vm_cachesize > 0 &&
-        (fp = fopen(vm_filename, "r")) != NULL)
-    {
-        while (i < vm_cachesize && getdelim(&s, &t, ',', fp) > 0)
-            vm_cache[i++] = (int64_t)atoll(s);
-        free(s);
-        fclose(fp);
-    }
-    return i;
-}
-
-// Copy program from cache to memory, and zero the padding
-// Pre: dat must be allocated to size datsize > 0
-//      mem must be allocated to size memsize >= datsize
-void vm_refresh(void)
-{
-    int64_t *src, *dst;
-    int i;
-
-    if (vm_cache != NULL && vm_memory != NULL &&
-        vm_cachesize > 0 && vm_cachesize <= vm_memorysize)
-    {
-        src = vm_cache;
-        dst = vm_memory;
-        i = vm_cachesize;
-        while (i--)
-            *dst++ = *src++;
-        i = vm_memorysize - vm_cachesize;
-        while (i--)
-            *dst++ = 0;
-    }
-}
-
-// Parse and execute all instructions in memory
-int vm_exec(int reset)
+// Run program from a fresh copy
+// Ret: ERR_OK or VM state after error
+int vm_restart(void)
 {
-    static int ip = 0;    // instruction pointer
-    static int base = 0;  // "relative base offset"
-    static int tick = 0;
-    int instr, opcode, parmode;
-    int64_t par[PAR_MAX], *tmpptr;
-    int i, j, k, tmpsize;
-
-    if (reset)
-    {
-        vm_refresh();
-        ip = 0;
-        base = 0;
-    }
-
-    while (ip >= 0 && ip < vm_memorysize)
-    {
-        // Get opcode and parameter modes from instruction
-        instr = vm_memory[ip++];       // get instruction, increment instr pointer
-        opcode = instr % 100;          // opcode part of instruction
-        instr /= 100;                  // this leaves parameter modes
-
-        // Look up opcode, halt if not found or too long
-        i = 0;
-        while (i < cpusize && opcode != cpu[i].opcode)
-            ++i;
-        if (i == cpusize)             // not in the language def?
-        {
-            #ifdef DEBUG
-            printf("Unknown opcode %d at %d\n", opcode, ip - 1);
-            #endif
-            return ERR_OPCODE_UNKNOWN;
-        }
-        if (ip + cpu[i].read + cpu[i].write > vm_memorysize)
-        {
-            #ifdef DEBUG
-            printf("Too many parameters for program size at %d\n", ip - 1);
-            #endif
-            return ERR_SEGFAULT_PARAM;
-        }
-
-        // Get "read" parameter(s)
-        for (j = 0; j < cpu[i].read; ++j)
-        {
-            par[j] = vm_memory[ip++];  // get immediate value, increment instr pointer
-            parmode = instr % 10;
-            instr /= 10;               // next parameter mode
-            if (parmode != PAR_IMM)    // par mode = positional or offset?
-            {
-                if (parmode == PAR_OFF)  // use base offset
-                    par[j] += base;
-                if (par[j] < 0 || par[j] >= vm_memorysize)
-                {
-                    #ifdef DEBUG
-                    printf("Read beyond program size: %+" PRId64 "\n", par[j] - vm_memorysize + 1);
-                    #endif
-                    return ERR_SEGFAULT_READ;
-                }
-                par[j] = vm_memory[par[j]];  // get positional value
-            }
-        }
-
-        // Get "write" parameter (always positional/offset but keep the address this time)
-        if (cpu[i].write)
-        {
-            par[j] = vm_memory[ip++];   // get address param, increment program counter
-            if (instr % 10 == PAR_OFF)  // par mode = offset?
-                par[j] += base;
-            if (par[j] >= vm_memorysize)
-            {
-                // Try to grow program size in chunks of VM_GROW
-                tmpsize = vm_memorysize;
-                while (tmpsize < par[j] + 1)
-                    tmpsize += VM_GROW;
-                if ((tmpptr = realloc(vm_memory, tmpsize * sizeof *vm_memory)) != NULL)
-                {
-                    // Success
-                    #ifdef DEBUG
-                    printf("Allocated more memory: cur=%d new=%d\n", vm_memorysize, tmpsize);
-                    printf("ip=%d base=%d tick=%d\n", ip, base, tick);
-                    #endif
-                    for (i = vm_memorysize; i < tmpsize; ++i)
-                        tmpptr[i] = 0;
-                    vm_memory = tmpptr;
-                    vm_memorysize = tmpsize;
-                } else
-                {
-                    // Out of memory
-                    #ifdef DEBUG
-                    printf("Unable to allocate more memory: cur=%d new=%d\n", vm_memorysize, tmpsize);
-                    printf("ip=%d base=%d tick=%d\n", ip, base, tick);
-                    #endif
-                    return ERR_OUTOFMEMORY;
-                }
-            }
-            if (par[j] < 0 || par[j] >= vm_memorysize)
-            {
-                #ifdef DEBUG
-                printf("Write beyond program size: %+" PRId64 "\n", par[j] - vm_memorysize + 1);
-                printf("ip=%d base=%d tick=%d\n", ip, base, tick);
-                #endif
-                return ERR_SEGFAULT_WRITE;
-            }
-        }
-
-        // Advance clock
-        ++tick;
-
-        // Execute instruction
-        switch (opcode)
-        {
-            case CPU_ADD: vm_memory[par[2]] = par[0] + par[1];  break;
-            case CPU_MUL: vm_memory[par[2]] = par[0] * par[1];  break;
-            case CPU_IN : vm_memory[par[0]] = vm_input();       break;
-            case CPU_OUT: vm_output(par[0]);                    break;
-            case CPU_JNZ: if ( par[0]) ip = par[1];             break;
-            case CPU_JZ : if (!par[0]) ip = par[1];             break;
-            case CPU_LT : vm_memory[par[2]] = par[0] < par[1];  break;
-            case CPU_EQ : vm_memory[par[2]] = par[0] == par[1]; break;
-            case CPU_RBO: base += par[0];                       break;
-            case CPU_HLT: return ERR_OK;
-            default :
-                #ifdef DEBUG
-                printf("Internal error: undefined opcode %d\n", opcode);
-                #endif
-                return ERR_OPCODE_UNDEFINED;
-        }
-    }
-    return ERR_SEGFAULT_OTHER;
+    VMState state = VM_STATE_ERR;
+
+    if (vm_init(&vm, vm_cache, vm_cachesize, 0))
+        #ifdef AOT
+        state = vm_aot_exec(&aot, &vm, vm_input, vm_output, NULL);
+        #else
+        state = vm_exec(&vm, vm_input, vm_output, NULL);
+        #endif
+    return state == VM_STATE_HLT ? ERR_OK : (int)state;
 }
 
 int asciichar(char c)
@@ -334,7 +107,7 @@ int asciilong(int64_t lc)
 }
 
 // Request value for input
-int64_t vm_input(void)
+VMType vm_input(void *arg)
 {
     static char *s = NULL;
     static size_t t = 0;
@@ -386,14 +159,16 @@ int64_t vm_input(void)
         }
     }
 
-    return vm_input();
+    return vm_input(arg);
 }
 
 // Process value for output
-void vm_output(int64_t val)
+void vm_output(VMType val, void *arg)
 {
     static int count = 0;
 
+    (void)arg;
+
     if (asciilong(val))
         printf("%c", (char)val);
     else
@@ -404,28 +179,27 @@ void vm_output(int64_t val)
 
 int main(int argc, char *argv[])
 {
-    int i, d, len, ret;
+    int i, d, ret;
 
     // Init AoC
     aoc_setfilename(aoc_thispuzzle(argv));
 
-    // Check program data
-    if ((len = aoc_csvfields()) > 0)
+    // Read program data
+    vm_cache = vm_load(vm_filename, &vm_cachesize);
+    if (vm_cache != NULL)
     {
-        // Allocate memory
-        vm_cachesize  = len;
-        vm_memorysize = len;  // no initial padding
-        vm_cache  = malloc(vm_cachesize  * sizeof *vm_cache );
-        vm_memory = malloc(vm_memorysize * sizeof *vm_memory);
-        // Read into memory
-        if (vm_cache != NULL && vm_memory != NULL && aoc_csv2cache() == len)
-        {
-            // Run program
-            if ((ret = vm_exec(VM_RESET)) != ERR_OK)
-                printf("Error: %d\n", ret);
-        }
-        free(vm_memory);
-        free(vm_cache);
+        #ifdef AOT
+        if (!vm_aot_open(&aot, vm_cache, vm_cachesize, NULL))
+            fputs("Native code not available, using interpreter.\n", stderr);
+        #endif
+        // Run program
+        if ((ret = vm_restart()) != ERR_OK)
+            printf("Error: %d\n", ret);
     }
+    #ifdef AOT
+    vm_aot_close(&aot);
+    #endif
+    vm_free(&vm);
+    free(vm_cache);
     return ERR_OK;
 }
@@ -5,59 +5,17 @@
  * By: E. Dronkert https://github.com/ednl
  */
 
-#include <stdio.h>
-#include <stdlib.h>  // calloc, realloc, free
-#include <stdint.h>  // uint16_t, int64_t
-#include <string.h>  // memset, memcpy
+#include <stdio.h>    // fopen, fread, fclose
+#include <stdlib.h>   // malloc, realloc, free
+#include <stdint.h>   // uint16_t, int64_t
+#include <string.h>   // memset, memcpy
 #include <stdbool.h>
 #include "intcode.h"
 
-enum vmstate {
-    VM_STATE_INI = 0,  // default state, needs to be initialised (calloc, fresh code)
-    VM_STATE_OK  = 1,  // ready to run
-    VM_STATE_RUN = 2,  // running
-    VM_STATE_SUS = 3,  // suspended, waiting for INP queue to fill or OUT queue to clear
-    VM_STATE_HLT = 4,  // halted after HLT
-    VM_STATE_ERR = 5,  // halted after error
-};
-
-enum vmopcode {
-    VM_OP_ADD =  1,  // add params and store
-    VM_OP_MUL =  2,  // multiply params and store
-    VM_OP_INP =  3,  // input & store value
-    VM_OP_OUT =  4,  // output value
-    VM_OP_JNZ =  5,  // if par0 != 0 then ip = par1
-    VM_OP_JZ  =  6,  // if par0 == 0 then ip = par1
-    VM_OP_LT  =  7,  // par2 = par0  < par1
-    VM_OP_EQ  =  8,  // par2 = par0 == par1
-    VM_OP_RBO =  9,  // relative base offset: adjust base
-    VM_OP_HLT = 99,  // halt program
-};
-
-enum vmparam {
-    VM_PAR_POS = 0,
-    VM_PAR_IMM = 1,
-    VM_PAR_REL = 2,
-    VM_PAR_SIZE
-};
-
-struct vmqueue {
-    VMType q[VM_QSIZE];  // fixed size for now
-    int cap, len, pop, ins;
-};
-
-struct vm {
-    VMType *mem;
-    int ip, base, size, id;
-    VMState state;
-    VMQueue inp;
-    VMQueue out;
-};
-
 // Opcodes can have read and/or write parameters, up to 3 in total
 // Read parameter can be positional (0), immediate (1), or relative (2)
 // Write parameter can be positional (0) or relative (2)
-const uint16_t vm_decode[] = {
+const uint16_t vm_decode[VM_DECODE_LEN] = {
     [    1] = 0x0103,  // 00000001 0000 0011  ADD: 2x read, 1x write
     [  101] = 0x0107,  // 00000001 0000 0111
     [  201] = 0x010B,  // 00000001 0000 1011
@@ -163,7 +121,11 @@ const uint16_t vm_decode[] = {
 int vm_parse(const char *const input, VMType *const code)
 {
     int n = 0;
-    for (const char *c = input; *c; ++c) {
+    for (const char *c = input; *c; ) {
+        if (*c != '-' && (*c < '0' || *c > '9')) {
+            ++c;  // skip separators, newline, carriage return
+            continue;
+        }
         const VMType sgn = *c == '-' ? (c++, -1) : 1;
         VMType x = 0;
         while (*c >= '0' && *c <= '9')
@@ -173,137 +135,519 @@ int vm_parse(const char *const input, VMType *const code)
     return n;
 }
 
+// Read one-line CSV file of signed ints to newly allocated array
+VMType *vm_load(const char *const fname, int *const len)
+{
+    *len = 0;
+    FILE *f = fopen(fname, "rb");
+    if (!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    const long fsize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *input = fsize > 0 ? malloc(fsize + 1) : NULL;
+    if (!input) {
+        fclose(f);
+        return NULL;
+    }
+    const size_t n = fread(input, 1, fsize, f);
+    fclose(f);
+    input[n] = '\0';
+    int count = 1;  // number of values = commas + 1
+    for (const char *c = input; *c; ++c)
+        count += *c == ',';
+    VMType *code = malloc(count * sizeof *code);
+    if (code)
+        *len = vm_parse(input, code);
+    free(input);
+    return code;
+}
+
+// Snapshot memory page, contents shared between snapshots and VMs
+struct vmpage {
+    int refs;
+    VMType val[VM_PAGE];
+};
+
+// Number of pages to cover memory size
+static int vm_pages(const int size)
+{
+    return (size + VM_PAGE - 1) >> VM_PAGEBITS;
+}
+
+// Release one reference to shared page
+static void vm_unref(VMPage *const page)
+{
+    if (page && !--page->refs)
+        free(page);
+}
+
+// Release all references to shared pages
+static void vm_unrefall(VMPage **const page, const int pages)
+{
+    if (page)
+        for (int i = 0; i < pages; ++i) {
+            vm_unref(page[i]);
+            page[i] = NULL;
+        }
+}
+
 // Resize (only larger) or free (size=0)
-bool vm_resize(VM *vm, const int newsize)
+// After the first allocation, grows to at least double the current size,
+// in multiples of VM_GROW
+bool vm_resize(VM *const vm, const int newsize)
 {
     if (newsize < 0)
         return false;
     if (newsize == 0) {
+        vm_unrefall(vm->page, vm_pages(vm->size));
         free(vm->mem);
+        free(vm->dec);
+        free(vm->page);
+        free(vm->dirty);
         vm->mem = NULL;
+        vm->dec = NULL;
+        vm->page = NULL;
+        vm->dirty = NULL;
         vm->size = 0;
         return true;
     }
     if (newsize <= vm->size)
         return true;
-    if (vm->mem) {
-        void *t = realloc(vm->mem, newsize * sizeof (VMType));
-        if (t == NULL)
-            return false;
-        memset(t + vm->size * sizeof (VMType), 0, (newsize - vm->size) * sizeof (VMType));
-        vm->mem = t;
-        vm->size = newsize;
-        return true;
+    int size = newsize;  // first allocation: exact size, e.g. program length
+    if (vm->size) {
+        if (size < vm->size * 2)
+            size = vm->size * 2;
+        size = (size + VM_GROW - 1) / VM_GROW * VM_GROW;
     }
-    void *t = calloc(newsize, sizeof (VMType));
-    if (t == NULL)
+    VMType *t = realloc(vm->mem, size * sizeof *t);
+    if (!t)
         return false;
     vm->mem = t;
-    vm->size = newsize;
+    uint16_t *d = realloc(vm->dec, size * sizeof *d);
+    if (!d)
+        return false;
+    vm->dec = d;
+    const int pages = vm_pages(vm->size), newpages = vm_pages(size);
+    VMPage **p = realloc(vm->page, newpages * sizeof *p);
+    if (!p)
+        return false;
+    vm->page = p;
+    uint8_t *w = realloc(vm->dirty, newpages * sizeof *w);
+    if (!w)
+        return false;
+    vm->dirty = w;
+    memset(t + vm->size, 0, (size - vm->size) * sizeof *t);
+    memset(d + vm->size, 0, (size - vm->size) * sizeof *d);
+    memset(p + pages, 0, (newpages - pages) * sizeof *p);  // new pages are not shared
+    memset(w + pages, 0, (newpages - pages) * sizeof *w);  // and all zero
+    vm->size = size;
+    return true;
+}
+
+// Set queue capacity, keep existing buffer if possible
+static bool vm_queue(VMQueue *const vmq, const int cap)
+{
+    if (cap != vmq->cap) {
+        VMType *t = realloc(vmq->q, cap * sizeof *t);
+        if (!t)
+            return false;
+        vmq->q = t;
+        vmq->cap = cap;
+    }
+    vmq->len = vmq->pop = vmq->ins = 0;
     return true;
 }
 
-// Full VM initialisation
-bool vm_init(VM *const vm, const VMType *const code, const int codesize)
+// Full VM initialisation, also for reuse of a VM that has run before
+bool vm_init(VM *const vm, const VMType *const code, const int codesize, const int qsize)
 {
     if (codesize <= 0)
         return false;
-    if (codesize > vm->size && !vm_resize(vm, codesize))
+    const int cap = qsize > 0 ? qsize : VM_QSIZE;
+    if (!vm_queue(&vm->inp, cap) || !vm_queue(&vm->out, cap))
+        return false;
+    const int used = vm->size;  // all of it might have been written to
+    if (!vm_resize(vm, codesize))
         return false;
-    memcpy(vm->mem, code, codesize * sizeof *code);  // fresh copy of intcode program
-    // vm->ip, vm->base, vm->id static init = 0
+    // Fresh copy of intcode program; new memory is all zero, and a
+    // pre-decoded instruction stays valid where the value is unchanged,
+    // so a rerun of the same program only decodes what it overwrote
+    VMType *const mem = vm->mem;
+    uint16_t *const dec = vm->dec;
+    for (int i = 0; i < codesize; ++i) {
+        dec[i] *= mem[i] == code[i];  // branchless
+        mem[i] = code[i];
+    }
+    if (used > codesize) {
+        memset(mem + codesize, 0, (used - codesize) * sizeof *mem);
+        memset(dec + codesize, 0, (used - codesize) * sizeof *dec);
+    }
+    const int pages = vm_pages(vm->size), codepages = vm_pages(codesize);
+    vm_unrefall(vm->page, pages);  // no longer equal to any snapshot
+    memset(vm->dirty, 1, codepages * sizeof *vm->dirty);  // page has code
+    memset(vm->dirty + codepages, 0, (pages - codepages) * sizeof *vm->dirty);  // page is zero
+    vm->ip = vm->base = 0;
     vm->state = VM_STATE_OK;  // initialisation done, ready to run
+    return true;
+}
+
+// Free memory and queues, VM can be initialised again
+void vm_free(VM *const vm)
+{
+    vm_unrefall(vm->page, vm_pages(vm->size));
+    free(vm->mem);
+    free(vm->dec);
+    free(vm->page);
+    free(vm->dirty);
+    free(vm->inp.q);
+    free(vm->out.q);
+    *vm = (VM){0};
+}
+
+// Write to memory of a VM that has already run
+bool vm_poke(VM *const vm, const int addr, const VMType val)
+{
+    if (addr < 0 || (addr >= vm->size && !vm_resize(vm, addr + 1)))
+        return false;
+    vm->mem[addr] = val;
+    vm->dec[addr] = 0;  // invalidate pre-decoded instruction
+    vm->dirty[addr >> VM_PAGEBITS] = 1;
+    return true;
+}
+
+// Copy queue contents, keep existing buffer if possible
+static bool vm_qcopy(VMQueue *const dst, const VMQueue *const src)
+{
+    if (!vm_queue(dst, src->cap))
+        return false;
+    memcpy(dst->q, src->q, src->cap * sizeof *src->q);
+    dst->len = src->len;
+    dst->pop = src->pop;
+    dst->ins = src->ins;
+    return true;
 }
 
-// Enqueue = push onto the head of the queue
-bool vm_enq(VMQueue *const vmq, const VMType val)
+// Save VM state to snapshot, only copy pages written to since the last
+// snapshot or fork; the VM then shares all its pages with the snapshot
+bool vm_snapshot(VM *const vm, VMSnap *const snap)
 {
-    if (vmq->len >= vmq->cap)
+    if (vm->state == VM_STATE_INI)
         return false;
-    vmq->len++;
-    vmq->q[vmq->ins++] = val;
-    if (vmq->ins >= vmq->cap)
-        vmq->ins = 0;
+    const int pages = vm_pages(vm->size);
+    VMPage **page = malloc(pages * sizeof *page);
+    if (!page)
+        return false;
+    for (int i = 0; i < pages; ++i) {
+        if (vm->dirty[i] || !vm->page[i]) {
+            VMPage *p = malloc(sizeof *p);
+            if (!p) {
+                vm_unrefall(page, i);
+                free(page);
+                return false;
+            }
+            const int n = i < pages - 1 ? VM_PAGE : vm->size - (i << VM_PAGEBITS);  // last page may be partial
+            memcpy(p->val, vm->mem + (i << VM_PAGEBITS), n * sizeof *p->val);
+            memset(p->val + n, 0, (VM_PAGE - n) * sizeof *p->val);
+            p->refs = 1;  // owned by VM
+            vm_unref(vm->page[i]);
+            vm->page[i] = p;
+            vm->dirty[i] = 0;
+        }
+        page[i] = vm->page[i];
+        page[i]->refs++;
+    }
+    vm_snapfree(snap);
+    if (!vm_qcopy(&snap->inp, &vm->inp) || !vm_qcopy(&snap->out, &vm->out)) {
+        vm_unrefall(page, pages);
+        free(page);
+        return false;
+    }
+    snap->page = page;
+    snap->ip = vm->ip;
+    snap->base = vm->base;
+    snap->size = vm->size;
+    snap->id = vm->id;
+    snap->state = vm->state;
     return true;
 }
 
-// Dequeue = pop off the tail of the queue
-bool vm_deq(VMQueue *const vmq, VMType *const val)
+// Continue from snapshot in VM, only copy pages that differ
+bool vm_fork(VM *const vm, const VMSnap *const snap)
 {
-    if (vmq->len <= 0)
+    if (!snap->page || !vm_resize(vm, snap->size))
         return false;
-    vmq->len--;
-    *val = vmq->q[vmq->pop++];
-    if (vmq->pop >= vmq->cap)
-        vmq->pop = 0;
+    if (!vm_qcopy(&vm->inp, &snap->inp) || !vm_qcopy(&vm->out, &snap->out))
+        return false;
+    const int snappages = vm_pages(snap->size), pages = vm_pages(vm->size);
+    for (int i = 0; i < snappages; ++i) {
+        if (vm->page[i] == snap->page[i] && !vm->dirty[i])
+            continue;  // same contents, pre-decoded instructions still valid
+        const int at = i << VM_PAGEBITS;
+        const int n = vm->size - at < VM_PAGE ? vm->size - at : VM_PAGE;
+        memcpy(vm->mem + at, snap->page[i]->val, n * sizeof *vm->mem);
+        memset(vm->dec + at, 0, n * sizeof *vm->dec);
+        snap->page[i]->refs++;
+        vm_unref(vm->page[i]);
+        vm->page[i] = snap->page[i];
+        vm->dirty[i] = 0;
+    }
+    for (int i = snappages; i < pages; ++i) {
+        if (!vm->page[i] && !vm->dirty[i])
+            continue;  // already all zero
+        const int at = i << VM_PAGEBITS;
+        const int n = vm->size - at < VM_PAGE ? vm->size - at : VM_PAGE;
+        memset(vm->mem + at, 0, n * sizeof *vm->mem);
+        memset(vm->dec + at, 0, n * sizeof *vm->dec);
+        vm_unref(vm->page[i]);
+        vm->page[i] = NULL;
+        vm->dirty[i] = 0;
+    }
+    vm->ip = snap->ip;
+    vm->base = snap->base;
+    vm->id = snap->id;
+    vm->state = snap->state;
     return true;
 }
 
-// Provide input value to VM
-bool vm_write_input(VM *const vm, const VMType inputval)
+// Release snapshot pages and queues
+void vm_snapfree(VMSnap *const snap)
+{
+    if (snap->page) {
+        vm_unrefall(snap->page, vm_pages(snap->size));
+        free(snap->page);
+    }
+    free(snap->inp.q);
+    free(snap->out.q);
+    *snap = (VMSnap){0};
+}
+
+// Start again from address 0 without restoring memory
+bool vm_rewind(VM *const vm)
 {
-    return vm_enq(&vm->inp, inputval);
+    if (vm->state == VM_STATE_INI)
+        return false;
+    vm->ip = vm->base = 0;
+    vm->inp.len = vm->inp.pop = vm->inp.ins = 0;
+    vm->out.len = vm->out.pop = vm->out.ins = 0;
+    vm->state = VM_STATE_OK;
+    return true;
 }
 
-// Retrieve output value from VM
-bool vm_read_output(VM *const vm, VMType *const outputval)
+// Write string as ASCII input, return number of chars written
+int vm_write_ascii(VM *const vm, const char *s)
 {
-    return vm_deq(&vm->out, outputval);
+    int n = 0;
+    for (; *s && vm_enq(&vm->inp, (unsigned char)*s); ++s, ++n);
+    return n;
 }
 
+// Pre-decoded instruction: vm_decode[] value with the opcode in the MSByte
+// replaced by a dense handler index, 0 = not decoded yet
+enum vmhandler {
+    VM_H_DEC, VM_H_ADD, VM_H_MUL, VM_H_INP, VM_H_OUT, VM_H_JNZ,
+    VM_H_JZ, VM_H_LT, VM_H_EQ, VM_H_RBO, VM_H_HLT
+};
+
+#if defined(__GNUC__) && !defined(VM_SWITCH)
+    #define VM_THREADED  // computed goto, GCC extension also in Clang
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+// Address of parameter i (0-2) for the instruction at ip, or grow memory
+// first and decode the same instruction again
+#define VM_ARG(i, a) do { \
+    const int mode_ = instr >> (2 * (i) + 2) & 3; \
+    a = mode_ == VM_PAR_IMM ? ip + 1 + (i) : \
+        mem[ip + 1 + (i)] + (mode_ == VM_PAR_REL ? base : 0); \
+    if ((uint64_t)(a) >= (uint64_t)size) { \
+        addr = a; \
+        goto grow; \
+    } \
+} while (0)
+
+// Store value at address a, invalidate pre-decoded instruction there,
+// mark page as no longer equal to its snapshot page
+#define VM_PUT(a, val) do { \
+    mem[a] = (val); \
+    dec[a] = 0; \
+    dirty[(a) >> VM_PAGEBITS] = 1; \
+} while (0)
+
+// Fetch pre-decoded instruction at ip and jump to its handler
+#ifdef VM_THREADED
+    #define VM_NEXT do { \
+        if ((unsigned)ip >= (unsigned)size) \
+            goto stop; \
+        instr = dec[ip]; \
+        goto *handler[instr >> 8]; \
+    } while (0)
+#else
+    #define VM_NEXT goto dispatch
+#endif
+
+// Run until halt, error, or suspended at INP (input queue empty)
+// or OUT (output queue full)
+// Instructions are decoded once per address into vm->dec[], writes to memory
+// invalidate the entry at that address. Operands are always read from memory,
+// so self-modifying writes to parameters need no invalidation. Parameters are
+// resolved before the instruction pointer advances, so when memory must grow,
+// the same instruction is simply dispatched again.
 VMState run(VM *const vm)
 {
-    VMType *p[VM_PAR_SIZE] = {0};  // max 3 instruction parameters
+    if (vm->state == VM_STATE_INI || vm->state >= VM_STATE_HLT)
+        return vm->state;  // not initialised, or no longer running
+#ifdef VM_THREADED
+    static const void *const handler[] = {
+        &&op_dec, &&op_add, &&op_mul, &&op_inp, &&op_out, &&op_jnz,
+        &&op_jz, &&op_lt, &&op_eq, &&op_rbo, &&op_hlt
+    };
+#endif
+    VMType *mem = vm->mem;
+    uint16_t *dec = vm->dec;
+    uint8_t *dirty = vm->dirty;
+    int ip = vm->ip, base = vm->base, size = vm->size;
+    VMState state = VM_STATE_ERR;
+    VMType addr, a0, a1, a2;
+    uint16_t instr;
     vm->state = VM_STATE_RUN;
-    for (; vm->ip >= 0 && vm->ip < vm->size; ) {  // TODO: check specs
-        const uint16_t instr = vm_decode[vm->mem[vm->ip++]];  // avoid decimal decoding
+    VM_NEXT;
 
-        const int parcount = instr & 3;  // param count in 2 LSBs
-        if (vm->ip + parcount > vm->size)  // TODO: check specs
-            return (vm->state = VM_STATE_ERR);  // param fetch beyond size
-        for (int i = 0, k = 2; i < parcount; ++i, k += 2) {
-            VMType *const ix = &vm->mem[vm->ip++];
-            VMType addr = *ix;
-            switch (instr >> k & 3) {
-                case VM_PAR_REL:
-                    addr += vm->base;
-                    /* fall-through */
-                case VM_PAR_POS:
-                    if (addr < 0)
-                        return (vm->state = VM_STATE_ERR);  // param fetch below zero
-                    if (addr >= vm->size && !vm_resize(vm, addr + 1))
-                        return (vm->state = VM_STATE_ERR);  // resize failed
-                    p[i] = &vm->mem[addr];
-                    break;
-                case VM_PAR_IMM:
-                    p[i] = ix;
-                    break;
-                default:
-                    return (vm->state = VM_STATE_ERR);  // unknown parmode
-            }
-        }
+#ifndef VM_THREADED
+dispatch:
+    if ((unsigned)ip >= (unsigned)size)
+        goto stop;  // instruction fetch out of range
+    instr = dec[ip];
+    switch (instr >> 8) {
+        case VM_H_DEC: goto op_dec;
+        case VM_H_ADD: goto op_add;
+        case VM_H_MUL: goto op_mul;
+        case VM_H_INP: goto op_inp;
+        case VM_H_OUT: goto op_out;
+        case VM_H_JNZ: goto op_jnz;
+        case VM_H_JZ : goto op_jz;
+        case VM_H_LT : goto op_lt;
+        case VM_H_EQ : goto op_eq;
+        case VM_H_RBO: goto op_rbo;
+        case VM_H_HLT: goto op_hlt;
+    }
+#endif
 
-        switch (instr >> 8) {  // MSByte = opcode
-            case VM_OP_ADD: *p[2] = *p[0] + *p[1]; break;
-            case VM_OP_MUL: *p[2] = *p[0] * *p[1]; break;
-            case VM_OP_INP:
-                if (vm_deq(&vm->inp, p[0]))
-                    break;
-                vm->ip -= 2;  // back to INP
-                return (vm->state = VM_STATE_SUS);  // input queue empty
-            case VM_OP_OUT:
-                if (vm_enq(&vm->out, *p[0]))
-                    break;
-                vm->ip -= 2;  // back to OUT
-                return (vm->state = VM_STATE_SUS);  // output queue full
-            case VM_OP_JNZ: if (*p[0] != 0) vm->ip = *p[1]; break;
-            case VM_OP_JZ : if (*p[0] == 0) vm->ip = *p[1]; break;
-            case VM_OP_LT : *p[2] = *p[0] <  *p[1]; break;
-            case VM_OP_EQ : *p[2] = *p[0] == *p[1]; break;
-            case VM_OP_RBO: vm->base += *p[0]; break;
-            case VM_OP_HLT: return (vm->state = VM_STATE_HLT);
-            default: return (vm->state = VM_STATE_ERR);  // unknown opcode
+op_dec: {
+        // Slow path: first time at this address, or instruction was overwritten
+        const VMType op = mem[ip];
+        if (op < 0 || op >= VM_DECODE_LEN || !vm_decode[op])
+            goto stop;  // unknown opcode or parmode
+        const uint16_t d = vm_decode[op];  // avoid decimal decoding
+        const int parcount = d & 3;  // param count in 2 LSBs
+        if (ip + parcount >= size) {
+            addr = ip + parcount;  // param fetch beyond size
+            goto grow;
         }
+        const int h = d >> 8 == VM_OP_HLT ? VM_H_HLT : d >> 8;  // opcodes 1-9 are also handler 1-9
+        dec[ip] = (uint16_t)(h << 8 | (d & 0xff));
+        VM_NEXT;
+    }
+op_add:
+    VM_ARG(0, a0); VM_ARG(1, a1); VM_ARG(2, a2);
+    VM_PUT(a2, mem[a0] + mem[a1]);
+    ip += 4;
+    VM_NEXT;
+op_mul:
+    VM_ARG(0, a0); VM_ARG(1, a1); VM_ARG(2, a2);
+    VM_PUT(a2, mem[a0] * mem[a1]);
+    ip += 4;
+    VM_NEXT;
+op_inp:
+    VM_ARG(0, a0);
+    if (vm->inp.len == 0) {
+        state = VM_STATE_INP;  // input queue empty, stay at INP
+        goto stop;
+    }
+    vm_deq(&vm->inp, &mem[a0]);
+    dec[a0] = 0;
+    dirty[a0 >> VM_PAGEBITS] = 1;
+    ip += 2;
+    VM_NEXT;
+op_out:
+    VM_ARG(0, a0);
+    if (!vm_enq(&vm->out, mem[a0])) {
+        state = VM_STATE_OUT;  // output queue full, stay at OUT
+        goto stop;
+    }
+    ip += 2;
+    VM_NEXT;
+op_jnz:
+    VM_ARG(0, a0); VM_ARG(1, a1);
+    if (mem[a0] != 0) {
+        if (mem[a1] < 0 || mem[a1] >= size)
+            goto stop;  // jump out of range
+        ip = (int)mem[a1];
+    } else
+        ip += 3;
+    VM_NEXT;
+op_jz:
+    VM_ARG(0, a0); VM_ARG(1, a1);
+    if (mem[a0] == 0) {
+        if (mem[a1] < 0 || mem[a1] >= size)
+            goto stop;  // jump out of range
+        ip = (int)mem[a1];
+    } else
+        ip += 3;
+    VM_NEXT;
+op_lt:
+    VM_ARG(0, a0); VM_ARG(1, a1); VM_ARG(2, a2);
+    VM_PUT(a2, mem[a0] < mem[a1]);
+    ip += 4;
+    VM_NEXT;
+op_eq:
+    VM_ARG(0, a0); VM_ARG(1, a1); VM_ARG(2, a2);
+    VM_PUT(a2, mem[a0] == mem[a1]);
+    ip += 4;
+    VM_NEXT;
+op_rbo:
+    VM_ARG(0, a0);
+    base += (int)mem[a0];
+    ip += 2;
+    VM_NEXT;
+op_hlt:
+    state = VM_STATE_HLT;  // stay at HLT
+    goto stop;
+grow:
+    // Slow path: address 'addr' is beyond memory size, then dispatch again
+    if (addr < 0 || addr > INT32_MAX - VM_GROW || !vm_resize(vm, (int)addr + 1))
+        goto stop;  // negative address, or resize failed
+    mem = vm->mem;
+    dec = vm->dec;
+    dirty = vm->dirty;
+    size = vm->size;
+    VM_NEXT;
+stop:
+    vm->ip = ip;
+    vm->base = base;
+    return (vm->state = state);
+}
+
+#ifdef VM_THREADED
+    #pragma GCC diagnostic pop
+#endif
+#undef VM_ARG
+#undef VM_PUT
+#undef VM_NEXT
+
+// Run to completion with callbacks
+VMState vm_exec(VM *const vm,
+    VMType (*input)(void *arg), void (*output)(VMType val, void *arg), void *arg)
+{
+    for (;;) {
+        const VMState state = run(vm);
+        for (VMType val; vm_read_output(vm, &val); )
+            if (output)
+                output(val, arg);
+        if (state == VM_STATE_INP && input)
+            vm_write_input(vm, input(arg));
+        else if (state != VM_STATE_OUT)
+            return state;
     }
-    return (vm->state = VM_STATE_ERR);  // instruction fetch beyond size
 }
@@ -1,47 +1,204 @@
+/**
+ * Advent of Code 2019
+ * Intcode computer, shared by all days that run Intcode programs
+ * https://adventofcode.com/2019
+ * By: E. Dronkert https://github.com/ednl
+ *
+ * Usage:
+ *     static VM vm;  // must start zeroed (static, or = {0})
+ *     int len;
+ *     VMType *code = vm_load("../aocinput/2019-09-input.txt", &len);
+ *     vm_init(&vm, code, len, 0);  // 0 = default queue capacity
+ *     vm_write_input(&vm, 1);
+ *     while (run(&vm) == VM_STATE_OUT)  // output queue full
+ *         ...vm_read_output(&vm, &val)...
+ *     vm_free(&vm);
+ *     free(code);
+ * Branching searches: vm_snapshot() once per state, vm_fork() to continue
+ * from any saved state, vm_snapfree() when done with it.
+ * Compile:
+ *     cc -std=c17 -Wall -Wextra -pedantic intcode.c 09.c
+ */
+
 #ifndef INTCODE_H
 #define INTCODE_H
-#include <stdint.h>
-#include <stdbool.h>
+
+#include <stdint.h>   // int64_t, uint16_t
+#include <stdbool.h>  // bool
 
 // VM constants
-#define VM_QSIZE 32
+#define VM_QSIZE   32  // default input and output queue capacity
+#define VM_GROW  1024  // memory grows in multiples of this many values
+#define VM_PAGEBITS 8  // snapshot memory is shared in pages of 2^8 values
+#define VM_PAGE (1 << VM_PAGEBITS)
 
 // VM uses 64-bit signed ints
 typedef int64_t VMType;
 
-typedef enum vmstate VMState;
+typedef enum vmstate {
+    VM_STATE_INI = 0,  // default state, needs to be initialised (zeroed VM, fresh code)
+    VM_STATE_OK  = 1,  // ready to run
+    VM_STATE_RUN = 2,  // running
+    VM_STATE_INP = 3,  // suspended at INP, waiting for input queue to fill
+    VM_STATE_OUT = 4,  // suspended at OUT, waiting for output queue to clear
+    VM_STATE_HLT = 5,  // halted after HLT
+    VM_STATE_ERR = 6,  // halted after error
+} VMState;
 
 // Day 2: "Encountering an unknown opcode means something went wrong."
-typedef enum vmopcode VMOpCode;
-typedef enum vmparam VMParam;
+typedef enum vmopcode {
+    VM_OP_ADD =  1,  // add params and store
+    VM_OP_MUL =  2,  // multiply params and store
+    VM_OP_INP =  3,  // input & store value
+    VM_OP_OUT =  4,  // output value
+    VM_OP_JNZ =  5,  // if par0 != 0 then ip = par1
+    VM_OP_JZ  =  6,  // if par0 == 0 then ip = par1
+    VM_OP_LT  =  7,  // par2 = par0  < par1
+    VM_OP_EQ  =  8,  // par2 = par0 == par1
+    VM_OP_RBO =  9,  // relative base offset: adjust base
+    VM_OP_HLT = 99,  // halt program
+} VMOpCode;
+
+typedef enum vmparam {
+    VM_PAR_POS = 0,
+    VM_PAR_IMM = 1,
+    VM_PAR_REL = 2,
+    VM_PAR_SIZE
+} VMParam;
+
+// Ring buffer of values, capacity set at VM initialisation
+typedef struct vmqueue {
+    VMType *q;
+    int cap, len, pop, ins;
+} VMQueue;
+
+// Reference counted memory page of a snapshot, shared by all snapshots
+// and VMs that have the same contents on that page
+typedef struct vmpage VMPage;
 
-typedef struct vmqueue VMQueue;
+// Memory, pre-decoded instruction per address (0 = not decoded),
+// per page of memory: snapshot page with the same contents (or NULL),
+// per page of memory: written to since last vm_init/vm_snapshot/vm_fork,
+// instruction pointer, relative base for parmode=2,
+// size of memory, user ID, state, input and output queues
+typedef struct vm {
+    VMType *mem;
+    uint16_t *dec;
+    VMPage **page;
+    uint8_t *dirty;
+    int ip, base, size, id;
+    VMState state;
+    VMQueue inp;
+    VMQueue out;
+} VM;
 
-// Memory, instruction pointer, offset
-// for parmode=2, size of memory, state
-typedef struct vm VM;
+// Saved VM state to fork from, memory pages are shared copy-on-write
+typedef struct vmsnap {
+    VMPage **page;
+    int ip, base, size, id;
+    VMState state;
+    VMQueue inp;
+    VMQueue out;
+} VMSnap;
 
 // Translation of parameter modes and opcode from
 // decimal to binary with added info: parameter count
 // MSByte = opcode
 // LSByte = 3x 2-bit parmode, 1x 2-bit parcount
-extern const uint16_t vm_decode[];
+#define VM_DECODE_LEN 22209
+extern const uint16_t vm_decode[VM_DECODE_LEN];
 
 // Parse one-line CSV of signed ints from input file to VM data
+// Return: number of values parsed
 extern int vm_parse(const char *const input, VMType *const code);
 
+// Read one-line CSV file of signed ints to newly allocated array
+// Return: array that caller must free, or NULL on error; count in *len
+extern VMType *vm_load(const char *const fname, int *const len);
+
 // Resize (only larger) or free (size=0)
-extern bool vm_resize(VM *vm, const int newsize);
+extern bool vm_resize(VM *const vm, const int newsize);
+
+// Full VM initialisation, also for reuse of a VM that has run before
+// Queue capacity qsize <= 0 means default VM_QSIZE
+extern bool vm_init(VM *const vm, const VMType *const code, const int codesize, const int qsize);
+
+// Free memory and queues, VM can be initialised again
+extern void vm_free(VM *const vm);
+
+// Write to memory of a VM that has already run; plain writes to vm->mem
+// are fine between vm_init() and the first run(), only within the code
+extern bool vm_poke(VM *const vm, const int addr, const VMType val);
 
-// Full VM initialisation
-extern bool vm_init(VM *const vm, const VMType *const code, const int codesize);
+// Save VM state to snapshot (zeroed, or freed by vm_snapfree), only pages
+// written to since the last snapshot or fork are copied, others are shared
+extern bool vm_snapshot(VM *const vm, VMSnap *const snap);
 
-// Queue management
-extern bool vm_enq(VMQueue *const vmq, const VMType val);
-extern bool vm_deq(VMQueue *const vmq, VMType *const val);
-extern bool vm_write_input(VM *const vm, const VMType inputval);
-extern bool vm_read_output(VM *const vm, VMType *const outputval);
+// Continue from snapshot in VM (zeroed, or in use), only pages that differ
+// from the snapshot are copied, so forking from the same or a nearby
+// snapshot over and over again is cheap
+extern bool vm_fork(VM *const vm, const VMSnap *const snap);
 
+// Release snapshot pages and queues
+extern void vm_snapfree(VMSnap *const snap);
+
+// Start again from address 0 with empty queues, but keep memory as it is:
+// much cheaper than vm_fork(), only for programs that write every value
+// before reading it, like the amplifiers of day 7
+extern bool vm_rewind(VM *const vm);
+
+// Queue management, inline because it is called for every value passed
+// between a VM and its caller
+
+// Enqueue = push onto the head of the queue
+static inline bool vm_enq(VMQueue *const vmq, const VMType val)
+{
+    if (vmq->len >= vmq->cap)
+        return false;
+    vmq->len++;
+    vmq->q[vmq->ins++] = val;
+    if (vmq->ins >= vmq->cap)
+        vmq->ins = 0;
+    return true;
+}
+
+// Dequeue = pop off the tail of the queue
+static inline bool vm_deq(VMQueue *const vmq, VMType *const val)
+{
+    if (vmq->len <= 0)
+        return false;
+    vmq->len--;
+    *val = vmq->q[vmq->pop++];
+    if (vmq->pop >= vmq->cap)
+        vmq->pop = 0;
+    return true;
+}
+
+// Provide input value to VM
+static inline bool vm_write_input(VM *const vm, const VMType inputval)
+{
+    return vm_enq(&vm->inp, inputval);
+}
+
+// Retrieve output value from VM
+static inline bool vm_read_output(VM *const vm, VMType *const outputval)
+{
+    return vm_deq(&vm->out, outputval);
+}
+
+// Write string as ASCII input, return number of chars written
+extern int vm_write_ascii(VM *const vm, const char *s);
+
+// Run until halt, error, or suspended at INP (input queue empty)
+// or OUT (output queue full)
+// Uses computed-goto dispatch with GCC/Clang, compile with -DVM_SWITCH
+// to use a plain switch instead
 extern VMState run(VM *const vm);
 
+// Run to completion with callbacks: every output value goes to 'output',
+// every time the VM waits for input, 'input' is asked for one value.
+// Either callback may be NULL: outputs are dropped, or run stops at INP.
+extern VMState vm_exec(VM *const vm,
+    VMType (*input)(void *arg), void (*output)(VMType val, void *arg), void *arg);
+
 #endif
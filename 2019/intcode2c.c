@@ -0,0 +1,33 @@
+/**
+ * Advent of Code 2019
+ * Translate an Intcode program to C, see intcode_aot.h
+ * https://adventofcode.com/2019
+ * By: E. Dronkert https://github.com/ednl
+ *
+ * Compile:
+ *     cc -std=c17 -Wall -Wextra -pedantic intcode.c intcode_aot.c intcode2c.c -ldl
+ * Usage:
+ *     ./a.out ../aocinput/2019-25-input.txt [function name] > 25_native.c
+ */
+
+#include <stdio.h>   // fprintf
+#include <stdlib.h>  // free
+#include "intcode.h"
+#include "intcode_aot.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s intcode.txt [function name]\n", argv[0]);
+        return 1;
+    }
+    int len;
+    VMType *code = vm_load(argv[1], &len);
+    if (!code) {
+        fprintf(stderr, "File not found: %s\n", argv[1]);
+        return 1;
+    }
+    const bool ok = vm_aot_emit(stdout, code, len, argc == 3 ? argv[2] : VM_AOT_FUNC);
+    free(code);
+    return !ok;
+}
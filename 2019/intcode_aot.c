@@ -0,0 +1,242 @@
+/**
+ * Advent of Code 2019
+ * Intcode ahead-of-time translator to C, and driver to compile and load it
+ * https://adventofcode.com/2019
+ * By: E. Dronkert https://github.com/ednl
+ */
+
+#define _POSIX_C_SOURCE 200809L  // mkstemp, fdopen, dlopen
+#include <stdio.h>    // FILE, fprintf, snprintf
+#include <stdlib.h>   // malloc, free, system, getenv, mkstemp
+#include <stdint.h>   // INT32_MAX
+#include <string.h>   // strlen, strrchr
+#include <stdbool.h>
+#include <unistd.h>   // unlink, close
+#include <dlfcn.h>    // dlopen, dlsym, dlclose
+#include "intcode.h"
+#include "intcode_aot.h"
+
+// Location of intcode.h for generated code: argument, environment variable
+// VM_AOT_INCLUDE, or directory of this source file as it was compiled. The
+// last one is relative to the build directory if __FILE__ was relative.
+static const char *includedir(const char *const dir, char *const buf, const size_t size)
+{
+    if (dir && *dir)
+        return dir;
+    const char *env = getenv(VM_AOT_INCLUDE);
+    if (env && *env)
+        return env;
+    const char *slash = strrchr(__FILE__, '/');
+    if (!slash)
+        return ".";
+    snprintf(buf, size, "%.*s", (int)(slash - __FILE__), __FILE__);
+    return buf;
+}
+
+// Instruction at address i that fits inside the program
+// Return: vm_decode[] value or 0
+static uint16_t decoded(const VMType *const code, const int len, const int i)
+{
+    const VMType op = code[i];
+    if (op < 0 || op >= VM_DECODE_LEN || !vm_decode[op])
+        return 0;
+    const uint16_t d = vm_decode[op];
+    return i + (d & 3) < len ? d : 0;
+}
+
+// Emit address of parameter i of instruction d at address 'at' into 'a<i>'
+static void emitaddr(FILE *const f, const uint16_t d, const int at, const int i)
+{
+    const int mode = d >> (2 * i + 2) & 3;
+    if (mode == VM_PAR_IMM)
+        fprintf(f, "    a%d = %d;\n", i, at + 1 + i);
+    else
+        fprintf(f, "    a%d = %smem[%d]; ADR(a%d, %d);\n",
+            i, mode == VM_PAR_REL ? "base + " : "", at + 1 + i, i, at);
+}
+
+// Emit jump to address 'to', via dispatch if it has no label
+static void emitgoto(FILE *const f, const VMType *const code, const int len, const int to)
+{
+    if (to >= 0 && to < len && decoded(code, len, to))
+        fprintf(f, "    goto L%d;\n", to);
+    else
+        fprintf(f, "    ip = %d; goto fallback;\n", to);
+}
+
+bool vm_aot_emit(FILE *const f, const VMType *const code, const int len, const char *const name)
+{
+    fprintf(f,
+        "// Generated by vm_aot_emit() from %d values of Intcode, do not edit\n"
+        "#include \"intcode.h\"\n"
+        "#define ADR(a, at) if ((uint64_t)(a) >= (uint64_t)size) { *need = (a); ip = (at); state = VM_STATE_RUN; goto stop; }\n"
+        "#define PUT(a, val) do { mem[a] = (val); dec[a] = 0; dirty[(a) >> VM_PAGEBITS] = 1; } while (0)\n"
+        "VMState %s(VM *const vm, VMType *const need);\n"
+        "VMState %s(VM *const vm, VMType *const need)\n"
+        "{\n"
+        "    if (vm->state == VM_STATE_INI || vm->state >= VM_STATE_HLT)\n"
+        "        return vm->state;\n"
+        "    VMType *const mem = vm->mem;\n"
+        "    uint16_t *const dec = vm->dec;\n"
+        "    uint8_t *const dirty = vm->dirty;\n"
+        "    const VMType size = vm->size;\n"
+        "    VMType base = vm->base, a0, a1, a2, t;\n"
+        "    int ip = vm->ip;\n"
+        "    VMState state = VM_STATE_RUN;\n"
+        "    *need = -1;\n"
+        "    vm->state = VM_STATE_RUN;\n"
+        "    if (size < %d)\n"
+        "        goto fallback;\n"
+        "dispatch:\n"
+        "    switch (ip) {\n",
+        len, name, name, len);
+    for (int i = 0; i < len; ++i)
+        if (decoded(code, len, i))
+            fprintf(f, "        case %d: goto L%d;\n", i, i);
+    fprintf(f,
+        "        default: goto fallback;\n"
+        "    }\n");
+
+    for (int at = 0; at < len; ++at) {
+        const uint16_t d = decoded(code, len, at);
+        if (!d)
+            continue;
+        const int op = d >> 8, parcount = d & 3, next = at + 1 + parcount;
+        fprintf(f, "L%d: if (mem[%d] != %lld) { ip = %d; goto fallback; }\n",
+            at, at, (long long)code[at], at);
+        for (int i = 0; i < parcount; ++i)
+            emitaddr(f, d, at, i);
+        switch (op) {
+            case VM_OP_ADD: fprintf(f, "    PUT(a2, mem[a0] + mem[a1]);\n"); break;
+            case VM_OP_MUL: fprintf(f, "    PUT(a2, mem[a0] * mem[a1]);\n"); break;
+            case VM_OP_LT : fprintf(f, "    PUT(a2, mem[a0] < mem[a1]);\n"); break;
+            case VM_OP_EQ : fprintf(f, "    PUT(a2, mem[a0] == mem[a1]);\n"); break;
+            case VM_OP_RBO: fprintf(f, "    base += mem[a0];\n"); break;
+            case VM_OP_INP:
+                fprintf(f,
+                    "    if (!vm->inp.len) { ip = %d; state = VM_STATE_INP; goto stop; }\n"
+                    "    t = vm->inp.q[vm->inp.pop]; if (++vm->inp.pop == vm->inp.cap) vm->inp.pop = 0; vm->inp.len--;\n"
+                    "    PUT(a0, t);\n", at);
+                break;
+            case VM_OP_OUT:
+                fprintf(f,
+                    "    if (vm->out.len >= vm->out.cap) { ip = %d; state = VM_STATE_OUT; goto stop; }\n"
+                    "    vm->out.q[vm->out.ins] = mem[a0]; if (++vm->out.ins == vm->out.cap) vm->out.ins = 0; vm->out.len++;\n",
+                    at);
+                break;
+            case VM_OP_JNZ:
+            case VM_OP_JZ: {
+                fprintf(f, "    if (mem[a0] %s 0) {\n", op == VM_OP_JNZ ? "!=" : "==");
+                const VMType to = code[at + 2];
+                if ((d >> 4 & 3) == VM_PAR_IMM && to >= 0 && to < len && decoded(code, len, (int)to))
+                    fprintf(f, "        if (mem[%d] == %lld) goto L%lld;\n", at + 2, (long long)to, (long long)to);
+                fprintf(f, "        t = mem[a1]; ip = %d; goto jump;\n    }\n", at);
+                break;
+            }
+            case VM_OP_HLT:
+                fprintf(f, "    ip = %d; state = VM_STATE_HLT; goto stop;\n", at);
+                continue;
+        }
+        emitgoto(f, code, len, next);
+    }
+
+    fprintf(f,
+        "jump:\n"
+        "    if (t < 0 || t >= size) { state = VM_STATE_ERR; goto stop; }\n"
+        "    ip = (int)t;\n"
+        "    goto dispatch;\n"
+        "fallback:\n"
+        "    *need = -1;\n"
+        "stop:\n"
+        "    vm->ip = ip;\n"
+        "    vm->base = (int)base;\n"
+        "    return (vm->state = state);\n"
+        "}\n");
+    return !ferror(f);
+}
+
+bool vm_aot_open(VMAot *const aot, const VMType *const code, const int len, const char *const incdir)
+{
+    *aot = (VMAot){0};
+    const char *tmp = getenv("TMPDIR");
+    char src[256], lib[272], dir[256], cmd[1024];
+    snprintf(src, sizeof src, "%s/vmaot-XXXXXX", tmp && *tmp ? tmp : "/tmp");
+    const int fd = mkstemp(src);
+    if (fd == -1) {
+        fprintf(stderr, "vm_aot_open: cannot create %s\n", src);
+        return false;
+    }
+    FILE *f = fdopen(fd, "w");
+    if (!f) {
+        close(fd);
+        unlink(src);
+        fprintf(stderr, "vm_aot_open: cannot write %s\n", src);
+        return false;
+    }
+    const bool ok = vm_aot_emit(f, code, len, VM_AOT_FUNC);
+    if (fclose(f) || !ok) {
+        unlink(src);
+        fprintf(stderr, "vm_aot_open: cannot write %s\n", src);
+        return false;
+    }
+    snprintf(lib, sizeof lib, "%s.so", src);
+    snprintf(cmd, sizeof cmd, VM_AOT_CC " -I'%s' -o '%s' '%s'", includedir(incdir, dir, sizeof dir), lib, src);
+    const int status = system(cmd);
+    unlink(src);
+    if (status) {
+        unlink(lib);
+        fprintf(stderr, "vm_aot_open: compiler failed (status %d): %s\n", status, cmd);
+        return false;
+    }
+    aot->lib = dlopen(lib, RTLD_NOW | RTLD_LOCAL);
+    unlink(lib);  // stays mapped until dlclose
+    if (!aot->lib) {
+        fprintf(stderr, "vm_aot_open: %s\n", dlerror());
+        return false;
+    }
+    *(void **)&aot->native = dlsym(aot->lib, VM_AOT_FUNC);  // POSIX-sanctioned cast
+    if (!aot->native) {
+        fprintf(stderr, "vm_aot_open: %s\n", dlerror());
+        vm_aot_close(aot);
+        return false;
+    }
+    return true;
+}
+
+void vm_aot_close(VMAot *const aot)
+{
+    if (aot->lib)
+        dlclose(aot->lib);
+    *aot = (VMAot){0};
+}
+
+VMState vm_aot_run(const VMAot *const aot, VM *const vm)
+{
+    if (!aot->native)
+        return run(vm);
+    for (;;) {
+        VMType need;
+        const VMState state = aot->native(vm, &need);
+        if (state != VM_STATE_RUN)
+            return state;
+        if (need < 0)
+            return run(vm);  // not translated: interpreter until suspended
+        if (need > INT32_MAX - VM_GROW || !vm_resize(vm, (int)need + 1))
+            return (vm->state = VM_STATE_ERR);
+    }
+}
+
+VMState vm_aot_exec(const VMAot *const aot, VM *const vm,
+    VMType (*input)(void *arg), void (*output)(VMType val, void *arg), void *arg)
+{
+    for (;;) {
+        const VMState state = vm_aot_run(aot, vm);
+        for (VMType val; vm_read_output(vm, &val); )
+            if (output)
+                output(val, arg);
+        if (state == VM_STATE_INP && input)
+            vm_write_input(vm, input(arg));
+        else if (state != VM_STATE_OUT)
+            return state;
+    }
+}
@@ -0,0 +1,74 @@
+/**
+ * Advent of Code 2019
+ * Intcode ahead-of-time translator to C, and driver to compile and load it
+ * https://adventofcode.com/2019
+ * By: E. Dronkert https://github.com/ednl
+ *
+ * Every address of the program that holds a valid instruction becomes a
+ * label in one C function, with parameter modes and direct jumps resolved
+ * at translation time. Parameters are still read from VM memory, so programs
+ * that modify their own parameters run natively. Every label first checks
+ * that its opcode is unchanged; if not, or for a jump to an address without
+ * a label, the native code returns and the interpreter takes over until the
+ * VM suspends. Memory grows the same way as with run().
+ *
+ * Usage:
+ *     static VMAot aot;
+ *     vm_aot_open(&aot, code, len, NULL);  // falls back to interpreter on failure
+ *     vm_init(&vm, code, len, 0);
+ *     state = vm_aot_run(&aot, &vm);  // same as run(&vm)
+ *     vm_aot_close(&aot);
+ * Compile:
+ *     cc -std=c17 -Wall -Wextra -pedantic intcode.c intcode_aot.c 13.c -ldl
+ */
+
+#ifndef INTCODE_AOT_H
+#define INTCODE_AOT_H
+
+#include <stdio.h>    // FILE
+#include <stdbool.h>  // bool
+#include "intcode.h"
+
+// Compiler command for the generated C source; include path for intcode.h
+// and file names are appended
+#ifndef VM_AOT_CC
+    #define VM_AOT_CC "cc -O2 -shared -fPIC -x c"
+#endif
+
+// Environment variable with the directory of intcode.h, if not given to vm_aot_open()
+#define VM_AOT_INCLUDE "VM_AOT_INCLUDE"
+
+// Name of the generated function in the shared library
+#define VM_AOT_FUNC "vm_native"
+
+// Generated function: like run(), but may return VM_STATE_RUN to ask for
+// more memory (*need >= 0 = highest address) or for the interpreter (-1)
+typedef VMState (*VMNative)(VM *const vm, VMType *const need);
+
+// Loaded native code, or NULL to always use the interpreter
+typedef struct vmaot {
+    void *lib;
+    VMNative native;
+} VMAot;
+
+// Write C source of native function 'name' for this program to file
+// Return: false on write error
+extern bool vm_aot_emit(FILE *const f, const VMType *const code, const int len, const char *const name);
+
+// Translate program to C, compile as shared library and load it
+// incdir: directory of intcode.h for the compiler; NULL = environment
+// variable VM_AOT_INCLUDE, else the directory intcode_aot.c was compiled in
+// Return: false if anything failed (reason on stderr), VM then runs in the interpreter
+extern bool vm_aot_open(VMAot *const aot, const VMType *const code, const int len, const char *const incdir);
+
+// Unload shared library
+extern void vm_aot_close(VMAot *const aot);
+
+// Same as run(): run until halt, error, or suspended at INP or OUT
+extern VMState vm_aot_run(const VMAot *const aot, VM *const vm);
+
+// Same as vm_exec(): run to completion with callbacks
+extern VMState vm_aot_exec(const VMAot *const aot, VM *const vm,
+    VMType (*input)(void *arg), void (*output)(VMType val, void *arg), void *arg);
+
+#endif
@@ -0,0 +1,145 @@
+/**
+ * Advent of Code 2019
+ * Batch of Intcode VMs running the same program, optionally in rings
+ * https://adventofcode.com/2019
+ * By: E. Dronkert https://github.com/ednl
+ */
+
+#include <stdlib.h>   // malloc, free
+#include <stdbool.h>
+#include <pthread.h>  // pthread_create, pthread_join
+#include "intcode.h"
+#include "vmbatch.h"
+#include "../cores.h"
+
+// Arbitrary limit to avoid dynamic allocation of thread arrays
+#define MAXTHREADS 64
+
+// Consecutive groups [beg,end) run by one thread
+typedef struct work {
+    VMBatch *batch;
+    int beg, end;
+} Work;
+
+bool vm_batch_init(VMBatch *const batch, const VMType *const code, const int codesize,
+    const int count, const int qsize)
+{
+    if (count <= 0)
+        return false;
+    vm_batch_free(batch);
+    batch->vm = calloc(count, sizeof *batch->vm);
+    batch->state = malloc(count * sizeof *batch->state);
+    batch->link = malloc(count * sizeof *batch->link);
+    if (!batch->vm || !batch->state || !batch->link)
+        goto fail;
+    batch->count = count;
+    if (!vm_init(&batch->vm[0], code, codesize, qsize) || !vm_snapshot(&batch->vm[0], &batch->snap))
+        goto fail;
+    if (!vm_batch_reset(batch) || !vm_batch_ring(batch, 1))
+        goto fail;
+    return true;
+fail:
+    vm_batch_free(batch);
+    return false;
+}
+
+bool vm_batch_reset(VMBatch *const batch)
+{
+    // Forks share pages (reference counts are not atomic), so not threaded
+    for (int i = 0; i < batch->count; ++i) {
+        if (!vm_fork(&batch->vm[i], &batch->snap))
+            return false;
+        batch->vm[i].id = i;
+        batch->state[i] = VM_STATE_OK;
+    }
+    return true;
+}
+
+bool vm_batch_ring(VMBatch *const batch, const int group)
+{
+    const int k = group > 1 ? group : 1;
+    if (batch->count % k)
+        return false;
+    batch->group = k;
+    for (int i = 0; i < batch->count; ++i)
+        batch->link[i] = k == 1 ? -1 : (i % k == k - 1 ? i - k + 1 : i + 1);
+    return true;
+}
+
+// Run one group of instances round-robin until none can make progress
+static void vm_group(VMBatch *const batch, const int beg, const int end)
+{
+    for (bool busy = true; busy; ) {
+        busy = false;
+        for (int i = beg; i < end; ++i) {
+            VM *const vm = &batch->vm[i];
+            if (batch->state[i] < VM_STATE_HLT) {
+                const int ip = vm->ip, inp = vm->inp.len, out = vm->out.len;
+                const VMState state = run(vm);
+                busy |= state != batch->state[i] || vm->ip != ip
+                    || vm->inp.len != inp || vm->out.len != out;
+                batch->state[i] = state;
+            }
+            const int j = batch->link[i];
+            if (j < 0)
+                continue;
+            VMQueue *const next = &batch->vm[j].inp;
+            for (VMType val; next->len < next->cap && vm_read_output(vm, &val); ) {
+                vm_enq(next, val);
+                busy = true;
+            }
+        }
+    }
+}
+
+// Parallel execution in separate threads: consecutive groups
+static void *loop(void *arg)
+{
+    const Work *w = arg;
+    const int k = w->batch->group;
+    for (int g = w->beg; g < w->end; ++g)
+        vm_group(w->batch, g * k, (g + 1) * k);
+    return NULL;
+}
+
+VMState vm_batch_run(VMBatch *const batch, const int threads)
+{
+    if (!batch->count)
+        return VM_STATE_ERR;
+    const int groups = batch->count / batch->group;
+    int t = threads > 0 ? (threads > MAXTHREADS ? MAXTHREADS : threads) : coresavail(1, MAXTHREADS);
+    if (t > groups)
+        t = groups;
+    Work work[MAXTHREADS];
+    if (t <= 1) {
+        work[0] = (Work){batch, 0, groups};
+        loop(&work[0]);
+    } else {
+        pthread_t tid[MAXTHREADS];
+        for (int i = 0; i < t; ++i) {
+            work[i] = (Work){batch, groups * i / t, groups * (i + 1) / t};
+            pthread_create(&tid[i], NULL, loop, &work[i]);
+        }
+        for (int i = 0; i < t; ++i)
+            pthread_join(tid[i], NULL);
+    }
+    VMState res = VM_STATE_HLT;
+    for (int i = 0; i < batch->count; ++i)
+        if (batch->state[i] == VM_STATE_ERR)
+            return VM_STATE_ERR;
+        else if (batch->state[i] < VM_STATE_HLT)
+            res = batch->state[i];
+    return res;
+}
+
+void vm_batch_free(VMBatch *const batch)
+{
+    if (batch->vm)
+        for (int i = 0; i < batch->count; ++i)
+            vm_free(&batch->vm[i]);
+    free(batch->vm);
+    free(batch->state);
+    free(batch->link);
+    vm_snapfree(&batch->snap);
+    *batch = (VMBatch){0};
+}
@@ -0,0 +1,67 @@
+/**
+ * Advent of Code 2019
+ * Batch of Intcode VMs running the same program, optionally in rings
+ * https://adventofcode.com/2019
+ * By: E. Dronkert https://github.com/ednl
+ *
+ * All instances are forked from one snapshot of the freshly loaded program,
+ * so they share its memory pages until they write to them. Instances are
+ * grouped: with group size 1 every instance is independent, with group
+ * size k every k consecutive instances form a ring where the output of one
+ * is the input of the next, like the amplifiers of day 7. Groups are
+ * divided over threads, each group runs in one thread.
+ *
+ * Usage:
+ *     static VMBatch batch;  // must start zeroed (static, or = {0})
+ *     vm_batch_init(&batch, code, len, 120 * 5, 0);
+ *     vm_batch_ring(&batch, 5);
+ *     ...vm_write_input(&batch.vm[i], phase)...
+ *     vm_batch_run(&batch, 0);  // 0 = all available cores
+ *     ...vm_read_output() or, for a closed ring, inp queue of first VM...
+ *     vm_batch_reset(&batch);  // fresh program for all instances
+ *     vm_batch_free(&batch);
+ * Compile:
+ *     cc -std=c17 -Wall -Wextra -pedantic intcode.c vmbatch.c ../cores.c 19.c -lpthread
+ */
+
+#ifndef VMBATCH_H
+#define VMBATCH_H
+
+#include <stdbool.h>  // bool
+#include "intcode.h"
+
+// Instances, snapshot of the fresh program they are forked from,
+// per instance (struct of arrays): last run state, index of instance
+// that receives its output (-1 = none, output stays in its queue),
+// number of instances, instances per group
+typedef struct vmbatch {
+    VM *vm;
+    VMSnap snap;
+    VMState *state;
+    int *link;
+    int count, group;
+} VMBatch;
+
+// Load the same program into 'count' instances, group size 1
+// Queue capacity qsize <= 0 means default VM_QSIZE
+extern bool vm_batch_init(VMBatch *const batch, const VMType *const code, const int codesize,
+    const int count, const int qsize);
+
+// Fresh program for all instances, keeps groups and links
+extern bool vm_batch_reset(VMBatch *const batch);
+
+// Connect every 'group' consecutive instances in a ring, group <= 1 means
+// independent instances; count must be a multiple of the group size
+extern bool vm_batch_ring(VMBatch *const batch, const int group);
+
+// Run all instances until every one has halted or is blocked, passing
+// values along the links; groups are divided over at most 'threads'
+// threads (0 = number of available cores)
+// Return: VM_STATE_ERR if any instance failed, else VM_STATE_INP or
+//         VM_STATE_OUT if any instance is blocked, else VM_STATE_HLT
+extern VMState vm_batch_run(VMBatch *const batch, const int threads);
+
+// Free all instances and the snapshot
+extern void vm_batch_free(VMBatch *const batch);
+
+#endif
@@ -5,9 +5,9 @@
  * By: E. Dronkert https://github.com/ednl
  *
  * Compile:
- *     cc -std=c17 -Wall -Wextra -pedantic ../topn.c 09.c
+ *     cc -std=c17 -Wall -Wextra -pedantic 09.c
  * Enable timer:
- *     cc -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c ../topn.c 09.c
+ *     cc -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c 09.c
  * Test output with timer enabled:
  *     ./a.out | tail -n1
  * Get minimum runtime from timer output in bash:
@@ -46,14 +46,6 @@ static int fillbasin(const int x, const int y, int *map)
     return area;
 }
 
-// Sort int array in descending order
-static int descending(const void *p, const void *q)
-{
-    const int a = *(const int *)p;
-    const int b = *(const int *)q;
-    return (a < b) - (b < a);
-}
-
 int main(void)
 {
     FILE *f = fopen(FNAME, "rb");
@@ -79,7 +71,7 @@ for (int TIMERLOOP = 0; TIMERLOOP < 1000; ++TIMERLOOP) {
                 basin[count++] = fillbasin(i, j, &map);  // part 2
                 risk += 1 + __builtin_ctz(map);  // part 1
             }
-    topn(basin, 3, count, sizeof *basin, descending);  // part 2
+    topn_int(basin, 3, count);  // part 2
     printf("%d %d\n", risk, basin[0] * basin[1] * basin[2]);  // 506 931200
 
 #ifdef TIMER
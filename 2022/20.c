@@ -7,6 +7,8 @@
  * Compile:
  *    clang -std=gnu17 -O3 -march=native -Wall -Wextra 20.c ../startstoptimer.c
  *    gcc   -std=gnu17 -O3 -march=native -Wall -Wextra 20.c ../startstoptimer.c
+ * Compare mixing engines on the same input:
+ *    gcc   -std=gnu17 -O3 -march=native -Wall -Wextra -DENGINE=0 20.c ../startstoptimer.c
  * Get minimum runtime:
  *     m=99999999;for((i=0;i<200;++i));do t=$(./a.out|tail -n1|awk '{print $2}');((t<m))&&m=$t&&echo $m;done
  * Minimum runtime:
@@ -14,10 +16,19 @@
  *     iMac 2013 (i5 Haswell 4570 3.2 GHz) : 105 ms
  *     Raspberry Pi 5 (2.4 GHz)            : 144 ms
  *     Raspberry Pi 4 (1.8 GHz)            : 263 ms
+ * (measured with the linked list engine)
+ *
+ * Engine 0: doubly linked list, walks up to N/2 nodes per move.
+ * Engine 1: the ring as a list of blocks of about sqrt(N) indices, each
+ * index remembers its block. Position of an index = sizes of the blocks
+ * before it + its place in the block; the k-th position is found the same
+ * way. Moving an index is then O(sqrt(N)): remove from one block, insert
+ * in another. Blocks that grow too big are evened out again.
  */
 
 #include <stdio.h>
 #include <stdlib.h>    // atoi
+#include <string.h>    // memmove
 #include <stdint.h>    // int64_t
 #include <inttypes.h>  // PRId64
 #include "../startstoptimer.h"
@@ -34,6 +45,16 @@
 // Ring buffer with N values has N-1 connections.
 #define M (N - 1)
 
+// Mixing engine: 0=linked list, 1=blocks of about sqrt(N)
+#ifndef ENGINE
+    #define ENGINE 1
+#endif
+#if ENGINE
+    #define BSIZE 64                          // initial block size
+    #define BLOCKS ((N + BSIZE - 1) / BSIZE)  // number of blocks
+    #define BCAP (BSIZE * 2)                  // max block size before evening out
+#endif
+
 // Last step of "decryption" algo = sum values n*OFS away from zero for n=1,2,3.
 #define OFS 1000
 #define OFS_A (OFS % N)
@@ -46,7 +67,12 @@
 #define REDUCED_KEY (KEY % M)
 
 // Seperate value and shift arrays to minimise no. of steps in circular buffer.
-static int value[N], shift[N], prev[N], next[N];
+static int value[N], shift[N];
+#if ENGINE
+static int block[BLOCKS][BCAP], blocklen[BLOCKS], where[N];
+#else
+static int prev[N], next[N];
+#endif
 
 // Smallest absolute no. of steps in circular buffer.
 static int centered_remainder(const int x)
@@ -60,26 +86,107 @@ static int centered_remainder(const int x)
     return b <= -a ? b : a;
 }
 
-// Read input file and return index of zero value.
-static int parse(void)
+#if ENGINE
+
+// Spread indices in ring order evenly over all blocks.
+static void spread(const int *const ring)
 {
-    FILE *f = fopen(NAME, "r");
-    if (!f)
-        return -1;  // file not found
-    char buf[8];
-    int zeroindex = -1;  // no zero found
-    for (int i = 0; i < N && fgets(buf, sizeof buf, f); ++i) {
-        value[i] = atoi(buf);
-        shift[i] = centered_remainder(value[i]);
+    for (int b = 0, i = 0; b < BLOCKS; ++b) {
+        const int end = (int)((int64_t)N * (b + 1) / BLOCKS);
+        blocklen[b] = end - i;
+        for (int j = 0; i < end; ++i, ++j) {
+            block[b][j] = ring[i];
+            where[ring[i]] = b;
+        }
+    }
+}
+
+// Restore original order.
+static void reset(void)
+{
+    int ring[N];
+    for (int i = 0; i < N; ++i)
+        ring[i] = i;
+    spread(ring);
+}
+
+// Even out block sizes, keep order.
+static void rebuild(void)
+{
+    int ring[N];
+    for (int b = 0, i = 0; b < BLOCKS; ++b)
+        for (int j = 0; j < blocklen[b]; ++j)
+            ring[i++] = block[b][j];
+    spread(ring);
+}
+
+// Position of index in the ring, and its place in the block.
+static int position(const int index, int *const place)
+{
+    const int b = where[index];
+    int pos = 0, j = 0;
+    for (int c = 0; c < b; ++c)
+        pos += blocklen[c];
+    while (block[b][j] != index)
+        ++j;
+    *place = j;
+    return pos + j;
+}
+
+// Block that holds ring position pos (on return: place in that block).
+static int findpos(int *const pos)
+{
+    int b = 0;
+    while (*pos >= blocklen[b])
+        *pos -= blocklen[b++];
+    return b;
+}
+
+// Also works for steps=0 to avoid check on every call, bc it only happens once.
+static void move(const int index, const int steps)
+{
+    int j, b = where[index];
+    int pos = position(index, &j);
+    // Remove
+    memmove(&block[b][j], &block[b][j + 1], (size_t)(--blocklen[b] - j) * sizeof **block);
+    // Find, in ring of M indices: insert before the index now at that position
+    pos = (pos + steps) % M;
+    if (pos < 0)
+        pos += M;
+    b = findpos(&pos);
+    // Insert
+    memmove(&block[b][pos + 1], &block[b][pos], (size_t)(blocklen[b]++ - pos) * sizeof **block);
+    block[b][pos] = index;
+    where[index] = b;
+    if (blocklen[b] == BCAP)
+        rebuild();
+}
+
+// Sum values 1000,2000,3000 away from zero.
+static int decrypt(const int startindex)
+{
+    int sum = 0;
+    int j;
+    const int start = position(startindex, &j);
+    for (int i = 1; i <= 3; ++i) {
+        int pos = (start + i * OFS_A) % N;
+        const int b = findpos(&pos);
+        sum += value[block[b][pos]];
+    }
+    return sum;
+}
+
+#else
+
+// Restore original order.
+static void reset(void)
+{
+    for (int i = 0; i < N; ++i) {
         prev[i] = i - 1;
         next[i] = i + 1;
-        if (!value[i])
-            zeroindex = i;
     }
-    fclose(f);
     prev[0] = M;
     next[M] = 0;
-    return zeroindex;
 }
 
 // Also works for steps=0 to avoid check on every call, bc it only happens once.
@@ -119,6 +226,27 @@ static int decrypt(const int startindex)
     return sum;
 }
 
+#endif
+
+// Read input file and return index of zero value.
+static int parse(void)
+{
+    FILE *f = fopen(NAME, "r");
+    if (!f)
+        return -1;  // file not found
+    char buf[8];
+    int zeroindex = -1;  // no zero found
+    for (int i = 0; i < N && fgets(buf, sizeof buf, f); ++i) {
+        value[i] = atoi(buf);
+        shift[i] = centered_remainder(value[i]);
+        if (!value[i])
+            zeroindex = i;
+    }
+    fclose(f);
+    reset();
+    return zeroindex;
+}
+
 int main(void)
 {
     starttimer();
@@ -132,13 +260,9 @@ int main(void)
     printf("Part 1: %d\n", decrypt(zeroindex));  // example=3, input=4066
 
     // Reset
-    for (int i = 0; i < N; ++i) {
+    for (int i = 0; i < N; ++i)
         shift[i] = centered_remainder(shift[i] * REDUCED_KEY);  // new shift value for part 2
-        prev[i] = i - 1;
-        next[i] = i + 1;
-    }
-    prev[0] = M;
-    next[M] = 0;
+    reset();
 
     // Part 2
     for (int k = 0; k < REPEAT; ++k)
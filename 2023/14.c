@@ -11,17 +11,28 @@
  * Get minimum runtime from timer output in bash:
  *     m=99999999;for((i=0;i<20000;++i));do t=$(./a.out|tail -n1|awk '{print $2}');((t<m))&&m=$t&&echo "$m ($i)";done
  * Minimum runtime measurements:
- *     Macbook Pro 2024 (M4 4.4 GHz)       : 10 ms
- *     Mac Mini 2020 (M1 3.2 GHz)          : 22 ms
- *     iMac 2013 (i5 Haswell 4570 3.2 GHz) : 37 ms
- *     Raspberry Pi 5 (2.4 GHz)            : 41 ms
- *     Raspberry Pi 4 (1.8 GHz)            : 87 ms
+ *     Macbook Pro 2024 (M4 4.4 GHz)       : ? µs
+ *     Mac Mini 2020 (M1 3.2 GHz)          : ? µs
+ *     iMac 2013 (i5 Haswell 4570 3.2 GHz) : ? µs
+ *     Raspberry Pi 5 (2.4 GHz)            : ? µs
+ *     Raspberry Pi 4 (1.8 GHz)            : ? µs
+ *
+ * Bitboard: one 128-bit word per row (bit j = column j) or, after a
+ * transpose, per column (bit i = row i). Square rocks never move, so every
+ * word is split once into runs of free cells. Tilting a word then only
+ * needs the number of round rocks in each run: they all end up at the low
+ * or the high end of the run. N and W roll to low bits, S and E to high
+ * bits. Between tilts the round rock board is transposed as a 128x128 bit
+ * matrix. Part 2 stores every state with its hash until one repeats.
  */
 
 #include <stdio.h>    // fopen, fclose, fgets, printf
-#include <string.h>   // memset
+#include <string.h>   // memcpy, memcmp
+#include <stdint.h>   // uint64_t
 #include <stdbool.h>  // bool
-#include "../startstoptimer.h"
+#ifdef TIMER
+    #include "../startstoptimer.h"
+#endif
 
 #define EXAMPLE 0
 #if EXAMPLE
@@ -31,143 +42,192 @@
     #define NAME "../aocinput/2023-14-input.txt"
     #define N 100
 #endif
-#define LIM (N + 1)
-#define DIM (N + 2)
+#define M 128  // bits per word = words per board
 #define CYCLES 1000000000
-#define STEADY 100  // how many cycles to reach steady state loop
-
-static char map[DIM][DIM + 2];
+#define MAXHIST 1024  // states to remember before a repeat must be found
+#define HASHSIZE (MAXHIST * 2)  // power of 2
+#define MAXRUNS (N * (N / 2 + 1))  // max runs of free cells per orientation
+
+typedef __uint128_t u128;
+
+// Orientation of words on the board
+typedef enum orient {
+    ROW, COL
+} Orient;
+
+// Run of free cells between square rocks: bits low .. above-1
+typedef struct run {
+    u128 low, above;
+} Run;
+
+static const u128 full = ((u128)1 << N) - 1;
+static u128 square[2][M];   // square rocks per row and per column
+static Run run[2][MAXRUNS];  // runs of free cells per row and per column
+static int first[2][N + 1];  // runs of word i are run[o][first[o][i] .. first[o][i+1]-1]
+static u128 single[2][M];   // free cells between two square rocks: nowhere to roll
+static u128 board[M];        // round rocks, row- or column-major
+static u128 hist[MAXHIST][N];  // round rocks per row after every cycle
+static uint64_t histhash[MAXHIST];
+static int histload[MAXHIST];
+static int table[HASHSIZE];    // index in hist + 1, 0 = empty
+
+static int popcount(const u128 x)
+{
+    return __builtin_popcountll((uint64_t)x) + __builtin_popcountll((uint64_t)(x >> 64));
+}
 
-// Transpose
-static void transpose(void)
+// Transpose 128x128 bit matrix in place (Guy Steele, see 14_transpose32.txt)
+static void transpose(u128 *const a)
 {
-    for (int i = 1; i < LIM; ++i)
-        for (int j = i + 1; j < LIM; ++j) {
-            const char tmp = map[i][j];
-            map[i][j] = map[j][i];
-            map[j][i] = tmp;
+    u128 m = ((u128)1 << 64) - 1;
+    for (int j = 64; j; j >>= 1, m ^= m << j)
+        for (int k = 0; k < M; k = ((k | j) + 1) & ~j) {
+            const u128 t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k | j] ^= t;
+            a[k] ^= t << j;
         }
 }
 
-#if EXAMPLE
-static void printmap(void)
+// Split every row or column into runs of free cells, longer than one
+static void findruns(const Orient o)
 {
-    for (int i = 0; i < DIM; ++i)
-        printf("%s", map[i]);  // string already has '\n'
-    printf("\n");
+    int n = 0;
+    for (int i = 0; i < N; ++i) {
+        first[o][i] = n;
+        u128 free = ~square[o][i] & full;
+        while (free) {
+            const u128 low = free & -free;
+            const u128 above = (free + low) & ~free;  // carry stops just above the run
+            if (above == low << 1)
+                single[o][i] |= low;
+            else
+                run[o][n++] = (Run){low, above};
+            free &= ~(above - low);
+        }
+    }
+    first[o][N] = n;
 }
-#endif
 
-// Roll round rocks all the way to the left or right
-static void roll(const bool left)
+// Roll round rocks to the low or high end of every run
+static void tilt(const Orient o, const bool high)
 {
-    for (int i = 1; i < LIM; ++i)  // rows
-        for (int j = 1; j < LIM; ++j) {  // cols
-            while (j < LIM && map[i][j] == '#')  // look for first round rock or empty space
-                ++j;
-            int end = j, rocks = 0;
-            while (end < LIM && map[i][end] != '#')  // look for first square rock
-                rocks += map[i][end++] == 'O';  // count round rocks
-            const int space = end - j - rocks;
-            if (rocks && space) {
-                char *dst1 = &map[i][j];
-                if (left) {
-                    char *dst2 = dst1 + rocks;
-                    memset(dst1, 'O', (size_t)rocks);  // round rocks to the left
-                    memset(dst2, '.', (size_t)space);  // open space to the right
-                } else {
-                    char *dst2 = dst1 + space;
-                    memset(dst1, '.', (size_t)space);  // open space to the left
-                    memset(dst2, 'O', (size_t)rocks);  // round rocks to the right
-                }
-            }
-            j = end;
+    for (int i = 0; i < N; ++i) {
+        const u128 r = board[i];
+        u128 out = r & single[o][i];
+        for (const Run *p = &run[o][first[o][i]], *end = &run[o][first[o][i + 1]]; p != end; ++p) {
+            const int k = popcount(r & (p->above - p->low));
+            out |= high ? p->above - (p->above >> k) : (p->low << k) - p->low;
         }
+        board[i] = out;
+    }
 }
 
-// Total load on the North support beams (if N = up)
-// Also used as unique configuration ID for cycle detection, which happens to work
+// Total load on the North support beams, board must be row-major
 static int load(void)
 {
     int sum = 0;
-    for (int i = 1; i < LIM; ++i) {  // rows
-        const int val = LIM - i;
-        for (int j = 1; j < LIM; ++j)
-            sum += (map[i][j] == 'O') * val;
-    }
+    for (int i = 0; i < N; ++i)
+        sum += popcount(board[i]) * (N - i);
     return sum;
 }
 
-// Roll N,W,S,E (begin and end with N = up)
+// Roll N,W,S,E, begin and end row-major
 static void cycle(void)
 {
-    transpose(); /* N = left */ roll(true);  // roll left  = N
-    transpose(); /* N = up   */ roll(true);  // roll left  = W
-    transpose(); /* N = left */ roll(false); // roll right = S
-    transpose(); /* N = up   */ roll(false); // roll right = E
+    transpose(board); tilt(COL, false);  // N
+    transpose(board); tilt(ROW, false);  // W
+    transpose(board); tilt(COL, true);   // S
+    transpose(board); tilt(ROW, true);   // E
+}
+
+static uint64_t hash(void)
+{
+    uint64_t h = 0;
+    for (int i = 0; i < N; ++i) {
+        h = (h ^ (uint64_t)board[i]) * 0x9e3779b97f4a7c15;
+        h = (h ^ (uint64_t)(board[i] >> 64)) * 0x9e3779b97f4a7c15;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+// Index of earlier identical state, or remember this one as state t
+// Return: -1 if new
+static int seen(const int t)
+{
+    const uint64_t h = hash();
+    int slot = (int)(h & (HASHSIZE - 1));
+    for (; table[slot]; slot = (slot + 1) & (HASHSIZE - 1)) {
+        const int i = table[slot] - 1;
+        if (histhash[i] == h && !memcmp(hist[i], board, sizeof *hist))
+            return i;
+    }
+    table[slot] = t + 1;
+    memcpy(hist[t], board, sizeof *hist);
+    histhash[t] = h;
+    histload[t] = load();
+    return -1;
+}
+
+#if EXAMPLE
+static void printmap(void)
+{
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j)
+            putchar(square[ROW][i] >> j & 1 ? '#' : board[i] >> j & 1 ? 'O' : '.');
+        putchar('\n');
+    }
+    putchar('\n');
 }
+#endif
 
 int main(void)
 {
     FILE *f = fopen(NAME, "r");
     if (!f)
         return 1;
-    for (int i = 1; i < LIM; ++i)
-        fgets(&map[i][1], DIM, f);  // leave room for border
+    char buf[N + 2];
+    for (int i = 0; i < N && fgets(buf, sizeof buf, f); ++i)
+        for (int j = 0; j < N; ++j) {
+            square[ROW][i] |= (u128)(buf[j] == '#') << j;
+            board[i]       |= (u128)(buf[j] == 'O') << j;
+        }
     fclose(f);
 
+#ifdef TIMER
     starttimer();
+#endif
 
-    memset(&map[0][1], '#', N);  // top and bottom border not used
-    memset(&map[DIM - 1][1], '#', N);
-    for (int i = 0; i < DIM; ++i) {
-        map[i][0] = '#';
-        map[i][DIM - 1] = '#';
-        map[i][DIM    ] = '\n';
-        map[i][DIM + 1] = '\0';
-    }
+    memcpy(square[COL], square[ROW], sizeof *square);
+    transpose(square[COL]);
+    findruns(ROW);
+    findruns(COL);
 
-    // Part 1, begin with N = up
-    #if EXAMPLE
-        printmap();
-    #endif
-    transpose(); /* N = left */ roll(true); // roll left = N
-    transpose(); /* N = up   */
+    // Part 1, on a copy of the start position
+    u128 start[M];
+    memcpy(start, board, sizeof board);
+    transpose(board); tilt(COL, false);  // N
+    transpose(board);
     #if EXAMPLE
         printmap();
     #endif
     printf("Part 1: %d\n", load());  // example: 136, input: 113525
 
     // Part 2
-    // Complete first cycle from part 1: begin with N = up
-    roll(true);  // roll left  = W
-    transpose(); /* N = left */ roll(false); // roll right = S
-    transpose(); /* N = up   */ roll(false); // roll right = E
-    #if EXAMPLE
-        printmap();
-    #endif
-
-    // Get reference value after 100 cycles
-    // (for my input enough to reach steady state loop)
-    for (int i = 1; i < STEADY; ++i)  // one cycle already done
-        cycle();
-    const int ref = load();  // not necessarily unique, but it works
-
-    // How long is the loop?
-    int loop = 0;
-    do {
-        cycle();
-        ++loop;
-    } while (load() != ref);
-
-    // How many left to reach all teh CYCLES in a whole number of loops?
-    const int mod = (CYCLES - STEADY) % loop;
-    for (int i = 0; i < mod; ++i)
+    memcpy(board, start, sizeof board);
+    int t = 0, prev;
+    while ((prev = seen(t)) < 0) {
+        if (++t == MAXHIST) {
+            fprintf(stderr, "No repeat in %d cycles.\n", MAXHIST);
+            return 2;
+        }
         cycle();
-
-    #if EXAMPLE
-        printmap();
-    #endif
-    printf("Part 2: %d\n", load());  // example: 64, input: 101292
-    printf("Time: %.0f ms\n", stoptimer_ms());
+    }
+    // State t is state prev again, loop length t - prev
+    const int final = prev + (CYCLES - prev) % (t - prev);
+    printf("Part 2: %d\n", histload[final]);  // example: 64, input: 101292
+#ifdef TIMER
+    printf("Time: %.0f us\n", stoptimer_us());
+#endif
+    return 0;
 }
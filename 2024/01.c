@@ -10,6 +10,9 @@
  *     cc -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c 01.c
  * Get minimum runtime from timer output in bash:
  *     m=99999999;for((i=0;i<20000;++i));do t=$(./a.out|tail -n1|awk '{print $2}');((t<m))&&m=$t&&echo "$m ($i)";done
+ * Benchmark parse and solve in-process (JSON output, see ../benchmark.h):
+ *     cc -O3 -march=native -mtune=native -DBENCH ../startstoptimer.c ../benchmark.c 01.c -lm
+ *     BENCH_RUNS=20000 ./a.out
  * Minimum runtime:
  *     Macbook Pro 2024 (M4 4.4 GHz) :  56 µs
  *     Mac Mini 2020 (M1 3.2 GHz)    :  92 µs
@@ -21,6 +24,9 @@
 #ifdef TIMER
     #include "../startstoptimer.h"
 #endif
+#ifdef BENCH
+    #include "../benchmark.h"
+#endif
 
 #define FNAME "../aocinput/2024-01-input.txt"
 #define FSIZE 16384  // >= input file size in bytes
@@ -28,6 +34,7 @@
 
 static char input[FSIZE];
 static int a[N], b[N];  // two columns of numbers
+static int distsum, simil;  // results of part 1 and 2
 
 // Qsort comparison: lowest to highest
 static int cmp_int_asc(const void *p, const void *q)
@@ -50,44 +57,62 @@ static int num5(const char **const c)
     return x;
 }
 
-int main(void)
+// Read numbers into columns
+static void parse(void *arg)
 {
-    // Read input file
-    FILE *f = fopen(FNAME, "rb");  // fread requires binary mode
-    if (!f) { fputs("File not found.\n", stderr); return EXIT_FAILURE; }
-    fread(input, sizeof input, 1, f);  // read whole file at once
-    fclose(f);
-
-#ifdef TIMER
-    // Excludes reading from disk
-    starttimer();
-#endif
-
-    // Read numbers into columns
+    (void)arg;
     const char *c = input;
     for (int i = 0; i < N; ++i) {
         a[i] = num5(&c); c += 3;  // 5 digits, 3 spaces
         b[i] = num5(&c); c++;     // 5 digits, newline
     }
+}
+
+static void solve(void *arg)
+{
+    (void)arg;
 
     // Sort columns
     qsort(a, N, sizeof *a, cmp_int_asc);
     qsort(b, N, sizeof *b, cmp_int_asc);
 
     // Part 1: sum distances of pairs a[i],b[i]
-    int distsum = 0;
+    distsum = 0;
     for (int i = 0; i < N; ++i)
         distsum += abs(a[i] - b[i]);
-    printf("Part 1: %d\n", distsum);  // 1320851
 
     // Part 2: "similarity" is sum of all products a[i] * count(a[i] in b)
-    int simil = 0;
+    simil = 0;
     for (int i = 0, j = 0; i < N; ++i) {  // for each a[i]
         while (j < N && a[i] > b[j])      // find matching b[j]
             ++j;
         while (j < N && a[i] == b[j])     // add each matching b[j]
             simil += b[j++];
     }
+}
+
+int main(void)
+{
+    // Read input file
+    FILE *f = fopen(FNAME, "rb");  // fread requires binary mode
+    if (!f) { fputs("File not found.\n", stderr); return EXIT_FAILURE; }
+    fread(input, sizeof input, 1, f);  // read whole file at once
+    fclose(f);
+
+#ifdef BENCH
+    bench_report("2024-01", parse, solve, NULL);
+#endif
+
+#ifdef TIMER
+    // Excludes reading from disk, per-region summary on stderr at exit
+    starttimer();
+    sst_begin("parse"); parse(NULL); sst_end();
+    sst_begin("solve"); solve(NULL); sst_end();
+#else
+    parse(NULL);
+    solve(NULL);
+#endif
+    printf("Part 1: %d\n", distsum);  // 1320851
     printf("Part 2: %d\n", simil);  // 26859182
 
 #ifdef TIMER
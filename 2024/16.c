@@ -5,23 +5,32 @@
  * By: E. Dronkert https://github.com/ednl
  *
  * Compile:
- *     cc -std=c17 -Wall -Wextra -pedantic 16.c
+ *     cc -std=c17 -Wall -Wextra -pedantic ../pqueue.c 16.c
  * Enable timer:
- *     cc -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c 16.c
+ *     cc -O3 -march=native -mtune=native -DTIMER ../startstoptimer.c ../pqueue.c 16.c
+ * Compare queues (PQ_RADIX, PQ_DIAL, PQ_DARY):
+ *     cc -O3 -march=native -mtune=native -DTIMER -DQUEUE=PQ_RADIX ../startstoptimer.c ../pqueue.c 16.c
  * Get minimum runtime from timer output in bash:
  *     m=99999999;for((i=0;i<20000;++i));do t=$(./a.out|tail -n1|awk '{print $2}');((t<m))&&m=$t&&echo "$m ($i)";done
  * Minimum runtime measurements:
  *     Macbook Pro 2024 (M4 4.4 GHz) : ? µs
  *     Mac Mini 2020 (M1 3.2 GHz)    : ? µs
  *     Raspberry Pi 5 (2.4 GHz)      : ? µs
+ *
+ * State = position + direction. Part 1: Dijkstra from the start, facing
+ * east. Part 2: also Dijkstra backwards from the end, in every direction.
+ * A tile is on a best path if for some direction the cost from the start
+ * plus the cost to the end equals the best score.
  */
 
 #include <stdio.h>
-#include <stdlib.h>  // qsort
 #include <stdbool.h>
-#include <limits.h>  // INT_MAX
+#include "../pqueue.h"
+#ifdef TIMER
+    #include "../startstoptimer.h"
+#endif
 
-#define EXAMPLE 1
+#define EXAMPLE 0
 #if EXAMPLE == 1
     #define FNAME "../aocinput/2024-16-example1.txt"
     #define N 15
@@ -32,114 +41,97 @@
     #define FNAME "../aocinput/2024-16-input.txt"
     #define N 141
 #endif
+#ifndef QUEUE
+    #define QUEUE PQ_DIAL
+#endif
 
 // Cost
 #define STEP 1
 #define TURN 1000
 
-typedef struct pos {
-    int x, y;
-} Pos;
-
 // Positive direction for y going down: right->down->left->up->right
 typedef enum dir {
     RIGHT, DOWN, LEFT, UP
 } Dir;
 
-typedef struct state {
-    Pos pos;
-    Dir dir;
-    int score;
-} State;
-
-// Same order as 'enum dir'
-static const Pos step[] = {{1,0},{0,1},{-1,0},{0,-1}};
+// Same order as 'enum dir', as offset in map
+static const int step[] = {1, N + 1, -1, -(N + 1)};
 static char map[N][N + 1];
-static int dist[N][N + 1];
-static bool seen[N][N + 1];
-static Pos end;
-
-static int cmp(const void *p, const void *q)
-{
-    const int a = *(const int *)p;
-    const int b = *(const int *)q;
-    if (a < b) return -1;
-    if (a > b) return  1;
-    return 0;
-}
-
-static Dir turnleft(const Dir dir)
-{
-    return (dir + 3) & 3;
-}
-
-static Dir turnright(const Dir dir)
-{
-    return (dir + 1) & 3;
-}
+static PQKey fromstart[N * (N + 1) * 4], toend[N * (N + 1) * 4];
+static PQArena arena;
 
-static bool eq(const Pos a, const Pos b)
+// State = (row * (N + 1) + col) * 4 + dir, arg = search backwards
+static int edges(const int from, PQEdge *const out, void *arg)
 {
-    return a.x == b.x && a.y == b.y;
+    const bool backwards = *(const bool *)arg;
+    const int pos = from >> 2;
+    const Dir dir = from & 3;
+    const int next = backwards ? pos - step[dir] : pos + step[dir];
+    int n = 0;
+    if (*(&map[0][0] + next) != '#')
+        out[n++] = (PQEdge){next << 2 | dir, STEP};
+    out[n++] = (PQEdge){pos << 2 | ((dir + 1) & 3), TURN};
+    out[n++] = (PQEdge){pos << 2 | ((dir + 3) & 3), TURN};
+    return n;
 }
 
-static Pos add(const Pos a, const Pos b)
+static PQKey search(const int *const start, const int count, const bool backwards, PQKey *const dist)
 {
-    return (Pos){a.x + b.x, a.y + b.y};
-}
-
-static void add_r(Pos *const a, const Pos b)
-{
-    a->x += b.x;
-    a->y += b.y;
-}
-
-static int update(const Pos p, const int tentative)
-{
-    if (map[p.y][p.x] != '#' && !seen[p.y][p.x] && tentative < dist[p.y][p.x]) {
-        dist[p.y][p.x] = tentative;
-        return tentative;
-    }
-    return dist[p.y][p.x];
-}
-
-static int walk(const State s)
-{
-    if (eq(s.pos, end))
-        return s.score;
-    // Update unvisited neighbours if necessary
-    int cost[3];
-    int cost[0] = update(add(s.pos, step[s.dir]), s.score + STEP);
-    int cost[1] = update(add(s.pos, step[turnleft(s.dir)]), s.score + TURN + STEP);
-    int cost[2] = update(add(s.pos, step[turnright(s.dir)]), s.score + TURN + STEP);
-    seen[s.pos.y][s.pos.x] = true;
-    qsort(cost, 3, sizeof *cost, cmp);
-    if (cost[0] == INT_MAX)
-        return INT_MAX;
-    // TODO
+    bool arg = backwards;
+    const PQGraph g = {
+        .states = N * (N + 1) * 4, .maxdeg = 3, .maxcost = TURN,
+        .edges = edges, .arg = &arg};
+    if (!arena.mem && !pq_arena_init(&arena, pq_search_need(&g, QUEUE)))
+        return PQ_ERR;
+    return pq_search(&g, start, count, dist, QUEUE, &arena);
 }
 
 int main(void)
 {
     FILE *f = fopen(FNAME, "rb");
     if (!f) return 1;
-    fread(map, sizeof map, 1, f);
+    if (fread(map, sizeof map, 1, f) != 1) return 2;
     fclose(f);
 
-    Pos start = {0};
+#ifdef TIMER
+    starttimer();
+#endif
+    int start = 0, end = 0;  // position as index in map
     for (int i = 1; i < N - 1; ++i)
-        for (int j = 1; j < N - 1; ++j) {
-            dist[i][j] = INT_MAX;
+        for (int j = 1; j < N - 1; ++j)
             switch (map[i][j]) {
-                case 'E': end   = (Pos){j, i}; break;
-                case 'S': start = (Pos){j, i}; dist[i][j] = 0; break;
+                case 'E': end   = i * (N + 1) + j; break;
+                case 'S': start = i * (N + 1) + j; break;
             }
-        }
-    State cur = {start, RIGHT, 0};
 
-    int score = 0;
-    // TODO
-    printf("Part1: %d\n", score);  // example 1: 7036, example 2: 11048, input: ?
+    // Part 1
+    const int from = start << 2 | RIGHT;
+    if (search(&from, 1, false, fromstart) == PQ_ERR)
+        return 3;
+    PQKey best = PQ_INF;
+    for (int d = 0; d < 4; ++d)
+        if (fromstart[end << 2 | d] < best)
+            best = fromstart[end << 2 | d];
+    printf("Part 1: %u\n", best);  // example 1: 7036, example 2: 11048, input: ?
+
+    // Part 2
+    const int to[4] = {end << 2 | RIGHT, end << 2 | DOWN, end << 2 | LEFT, end << 2 | UP};
+    if (search(to, 4, true, toend) == PQ_ERR)
+        return 3;
+    int tiles = 0;
+    for (int pos = 0; pos < N * (N + 1); ++pos)
+        for (int d = 0; d < 4; ++d) {
+            const int s = pos << 2 | d;
+            if (fromstart[s] != PQ_INF && toend[s] != PQ_INF && fromstart[s] + toend[s] == best) {
+                ++tiles;
+                break;
+            }
+        }
+    printf("Part 2: %d\n", tiles);  // example 1: 45, example 2: 64, input: ?
 
+#ifdef TIMER
+    printf("Time: %.0f us\n", stoptimer_us());
+#endif
+    pq_arena_free(&arena);
     return 0;
 }
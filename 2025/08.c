@@ -22,7 +22,7 @@
 #include <stdint.h>    // int64_t
 #include <inttypes.h>  // PRId64
 #include <stdbool.h>
-#include "../topn.h"   // topn
+#include "../topn.h"   // topn, topn_int
 #ifdef TIMER
     #include "../startstoptimer.h"
 #endif
@@ -78,15 +78,6 @@ static int64_t sqrdist(const int i, const int j)
     return sqrsum(sub(junctionbox[i], junctionbox[j]));
 }
 
-static int desc(const void *p, const void *q)
-{
-    const int a = *(const int *)p;
-    const int b = *(const int *)q;
-    if (a < b) return  1;
-    if (a > b) return -1;
-    return 0;
-}
-
 static int cmpdist(const void *p, const void *q)
 {
     const Pair *a = p;
@@ -255,7 +246,7 @@ int main(void)
         for (int i = 0; i < circuitcount; ++i)
             if (circuit[i].len > 1)
                 circuitsize[k++] = circuit[i].len;
-        topn(circuitsize, 3, k, sizeof *circuitsize, desc);
+        topn_int(circuitsize, 3, k);
     }
     printf("Part 1: %d\n", circuitsize[0] * circuitsize[1] * circuitsize[2]);  // example: 40, input: 163548
     printf("Part 2: %"PRId64"\n", addpairs(M, PAIRS));  // example: 25272, input: 772452514
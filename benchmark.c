@@ -0,0 +1,125 @@
+/**
+ * BENCHMARK HARNESS
+ * Run a solve function many times in-process and report statistics.
+ * Freeware. No pull requests accepted.
+ * https://github.com/ednl
+ *
+ * Replaces the shell loop of thousands of program runs that only kept the
+ * minimum: no fork/exec per sample, and min/median/p99/stddev from one run.
+ * Output is one JSON object per line so results can be collected with e.g.:
+ *     ./a.out | grep '^{' >> bench.jsonl
+ */
+
+#if __linux__
+    #define _GNU_SOURCE  // must come before all includes, not just sched.h
+    #include <sched.h>   // sched_setaffinity
+#endif
+#include <stdio.h>   // FILE, fprintf
+#include <stdlib.h>  // malloc, free, qsort, getenv, atoi
+#include <math.h>    // sqrt
+#include "startstoptimer.h"
+#include "benchmark.h"
+
+// Integer setting from environment variable, or default value
+static int envint(const char *const name, const int def)
+{
+    const char *s = getenv(name);
+    return s && *s ? atoi(s) : def;
+}
+
+// Qsort helper function: sort doubles ascending
+static int cmp_dbl_asc(const void *p, const void *q)
+{
+    const double a = *(const double *)p;
+    const double b = *(const double *)q;
+    if (a < b) return -1;
+    if (a > b) return  1;
+    return 0;
+}
+
+BenchConfig bench_config(void)
+{
+    return (BenchConfig){
+        .warmup = envint("BENCH_WARMUP", 10),
+        .runs   = envint("BENCH_RUNS", 1000),
+        .cpu    = envint("BENCH_CPU", 0)
+    };
+}
+
+bool bench_pin(const int cpu)
+{
+#if __linux__
+    if (cpu < 0)
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return !sched_setaffinity(0, sizeof set, &set);
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+BenchStats bench_run(const BenchConfig *const cfg, BenchFun setup, BenchFun fun, void *arg)
+{
+    BenchStats stats = {0};
+    const int runs = cfg->runs > 0 ? cfg->runs : 1;
+    double *t = malloc((size_t)runs * sizeof *t);
+    if (!t)
+        return stats;
+
+    for (int i = 0; i < cfg->warmup; ++i) {
+        if (setup)
+            setup(arg);
+        fun(arg);
+    }
+
+    starttimer();  // once, for the performance warning
+    for (int i = 0; i < runs; ++i) {
+        if (setup)
+            setup(arg);
+        resettimer();
+        fun(arg);
+        t[i] = stoptimer_ns();
+    }
+
+    double sum = 0;
+    for (int i = 0; i < runs; ++i)
+        sum += t[i];
+    const double mean = sum / runs;
+    double var = 0;
+    for (int i = 0; i < runs; ++i)
+        var += (t[i] - mean) * (t[i] - mean);
+
+    qsort(t, (size_t)runs, sizeof *t, cmp_dbl_asc);
+    stats = (BenchStats){
+        .runs   = runs,
+        .min    = t[0],
+        .median = runs & 1 ? t[runs / 2] : (t[runs / 2 - 1] + t[runs / 2]) / 2,
+        .p99    = t[(runs * 99 + 99) / 100 - 1],  // nearest rank
+        .mean   = mean,
+        .stddev = runs > 1 ? sqrt(var / (runs - 1)) : 0
+    };
+    free(t);
+    return stats;
+}
+
+void bench_print(FILE *const f, const char *const name, const char *const phase, const BenchStats *const stats)
+{
+    fprintf(f, "{\"name\":\"%s\",\"phase\":\"%s\",\"runs\":%d,"
+        "\"min_ns\":%.0f,\"median_ns\":%.0f,\"p99_ns\":%.0f,\"mean_ns\":%.1f,\"stddev_ns\":%.1f}\n",
+        name, phase, stats->runs,
+        stats->min, stats->median, stats->p99, stats->mean, stats->stddev);
+}
+
+void bench_report(const char *const name, BenchFun parse, BenchFun solve, void *arg)
+{
+    const BenchConfig cfg = bench_config();
+    if (!bench_pin(cfg.cpu) && cfg.cpu >= 0)
+        fprintf(stderr, "Warning: could not pin to CPU %d.\n", cfg.cpu);
+    BenchStats s = bench_run(&cfg, NULL, parse, arg);
+    bench_print(stdout, name, "parse", &s);
+    s = bench_run(&cfg, parse, solve, arg);
+    bench_print(stdout, name, "solve", &s);
+}
@@ -0,0 +1,52 @@
+/**
+ * BENCHMARK HARNESS
+ * Run a solve function many times in-process and report statistics.
+ * Freeware. No pull requests accepted.
+ * https://github.com/ednl
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdio.h>    // FILE
+#include <stdbool.h>  // bool
+
+// Function to be timed, or to be run untimed before each timed run
+typedef void (*BenchFun)(void *arg);
+
+// Run-time settings, see bench_config()
+typedef struct benchconfig {
+    int warmup;  // untimed runs before measuring, to warm up caches and branch predictors
+    int runs;    // timed runs
+    int cpu;     // pin thread to this core, or -1 to not pin
+} BenchConfig;
+
+// Statistics of one set of timed runs, all times in nanoseconds
+typedef struct benchstats {
+    int runs;
+    double min, median, p99, mean, stddev;
+} BenchStats;
+
+// Default settings, overridden by environment variables
+// BENCH_WARMUP (default 10), BENCH_RUNS (default 1000), BENCH_CPU (default 0)
+BenchConfig bench_config(void);
+
+// Pin calling thread to one CPU core. Return false if not possible
+// (not supported on macOS, which only allows affinity hints).
+bool bench_pin(const int cpu);
+
+// Call fun(arg) cfg->warmup times untimed, then cfg->runs times timed.
+// If setup is not NULL, setup(arg) is called untimed before every run of fun,
+// e.g. to parse input again when fun modifies it.
+// Returns statistics of timed runs in nanoseconds.
+BenchStats bench_run(const BenchConfig *const cfg, BenchFun setup, BenchFun fun, void *arg);
+
+// Print statistics as one line of JSON, e.g.:
+// {"name":"2024-01","phase":"solve","runs":1000,"min_ns":..,"median_ns":..,"p99_ns":..,"mean_ns":..,"stddev_ns":..}
+void bench_print(FILE *const f, const char *const name, const char *const phase, const BenchStats *const stats);
+
+// Benchmark parse and solve separately and print both to stdout.
+// Pins to cfg.cpu first. Solve is run after an untimed parse every time.
+void bench_report(const char *const name, BenchFun parse, BenchFun solve, void *arg);
+
+#endif  // BENCHMARK_H
@@ -252,3 +252,455 @@ combperm_plainchanges_reset:
     len = last = move = 0;
     return NULL;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Reentrant versions with caller-owned iterator state
+////////////////////////////////////////////////////////////////////////////////
+
+// Number of combinations of k from n = binomial coefficient, or 0 if out of range.
+// Saturates at UINT64_MAX instead of overflowing.
+uint64_t comb_count(const int n, int k)
+{
+    if (k < 0 || n < 0 || k > n)
+        return 0;
+    if (k > n - k)
+        k = n - k;
+    uint64_t c = 1;
+    for (int i = 1; i <= k; ++i) {
+        const uint64_t f = (uint64_t)(n - k + i);
+        if (c > UINT64_MAX / f)
+            return UINT64_MAX;
+        c = c * f / (uint64_t)i;  // exact: c*f is always divisible by i
+    }
+    return c;
+}
+
+// Number of permutations of n = factorial, saturates at UINT64_MAX (from n=21).
+uint64_t perm_count(const int n)
+{
+    uint64_t f = 1;
+    for (int i = 2; i <= n; ++i) {
+        if (f > UINT64_MAX / (uint64_t)i)
+            return UINT64_MAX;
+        f *= (uint64_t)i;
+    }
+    return f;
+}
+
+bool comb_init(CombIter *const it, const int n, const int k)
+{
+    *it = (CombIter){0};
+    if (n <= 0 || k <= 0 || n <= k)
+        return false;
+    it->index = malloc((size_t)(k + 2) * sizeof *it->index);
+    if (!it->index)
+        return false;
+    it->n = n;
+    it->k = k;
+    return comb_seek(it, 0);
+}
+
+// Combinations are in colex order: rank = sum of C(index[i], i+1).
+uint64_t comb_rank(const int *const index, const int k)
+{
+    uint64_t rank = 0;
+    for (int i = 0; i < k; ++i)
+        rank += comb_count(index[i], i + 1);
+    return rank;
+}
+
+// Unrank greedily from the highest index down.
+void comb_unrank(uint64_t rank, const int n, const int k, int *const index)
+{
+    int c = n;
+    for (int i = k - 1; i >= 0; --i) {
+        uint64_t b;
+        do
+            b = comb_count(--c, i + 1);
+        while (b > rank);
+        index[i] = c;
+        rank -= b;
+    }
+}
+
+bool comb_seek(CombIter *const it, const uint64_t rank)
+{
+    if (!it->index || rank >= comb_count(it->n, it->k))
+        return false;
+    comb_unrank(rank, it->n, it->k, it->index);
+    it->index[it->k    ] = it->n;
+    it->index[it->k + 1] = 0;
+    // Algorithm T invariant: j+1 is the smallest i with index[i] > i
+    int i = 0;
+    while (it->index[i] == i)
+        ++i;
+    it->j = i - 1;
+    it->fresh = true;
+    it->done = false;
+    return true;
+}
+
+// Same steps as combinations(), with state from iterator.
+int *comb_next(CombIter *const it)
+{
+    int *const index = it->index;
+    if (!index || it->done)
+        return NULL;
+    if (it->fresh) {
+        it->fresh = false;
+        return index;
+    }
+    if (it->j >= 0) {
+        index[it->j] = it->j + 1;
+        it->j--;
+        return index;
+    }
+    if (index[0] + 1 < index[1]) {
+        index[0]++;
+        return index;
+    }
+    int j = 0, x;
+    do {
+        j++;
+        index[j - 1] = j - 1;
+    } while ((x = index[j] + 1) == index[j + 1]);
+    if (j < it->k) {
+        index[j--] = x;
+        it->j = j;
+        return index;
+    }
+    it->done = true;
+    return NULL;
+}
+
+void comb_free(CombIter *const it)
+{
+    free(it->index);
+    *it = (CombIter){0};
+}
+
+bool perm_init(PermIter *const it, const int count)
+{
+    *it = (PermIter){0};
+    if (count < 1)
+        return false;
+    it->index = malloc((size_t)count * sizeof *it->index);
+    if (!it->index)
+        return false;
+    it->count = count;
+    return perm_seek(it, 0);
+}
+
+// Lexicographic rank in factorial number system (Lehmer code).
+uint64_t perm_rank(const int *const index, const int count)
+{
+    uint64_t rank = 0;
+    for (int i = 0; i < count - 1; ++i) {
+        int d = 0;  // number of smaller values after position i
+        for (int j = i + 1; j < count; ++j)
+            d += index[j] < index[i];
+        rank = rank * (uint64_t)(count - i) + (uint64_t)d;
+    }
+    return rank;
+}
+
+void perm_unrank(uint64_t rank, const int count, int *const index)
+{
+    for (int i = 0; i < count; ++i)
+        index[i] = i;
+    for (int i = 0; i < count - 1; ++i) {
+        const uint64_t f = perm_count(count - 1 - i);
+        const int d = (int)(rank / f);  // which of the remaining values comes next
+        rank %= f;
+        const int val = index[i + d];
+        memmove(&index[i + 1], &index[i], (size_t)d * sizeof *index);
+        index[i] = val;
+    }
+}
+
+bool perm_seek(PermIter *const it, const uint64_t rank)
+{
+    if (!it->index || rank >= perm_count(it->count))
+        return false;
+    perm_unrank(rank, it->count, it->index);
+    it->fresh = true;
+    return true;
+}
+
+// Same steps as permutations(), with state from iterator.
+int *perm_next(PermIter *const it)
+{
+    int *const index = it->index;
+    const int len = it->count;
+    if (!index)
+        return NULL;
+    if (it->fresh) {
+        it->fresh = false;
+        return index;
+    }
+    int px = len - 2;
+    while (px >= 0 && index[px] >= index[px + 1])
+        --px;
+    if (px < 0)
+        return NULL;  // final permutation is unchanged, so next call also ends here
+    int py = len - 1;
+    while (index[px] >= index[py])
+        --py;
+    swap(&index[px], &index[py]);
+    for (int l = px + 1, r = len - 1; l < r; ++l, --r)
+        swap(&index[l], &index[r]);
+    return index;
+}
+
+void perm_free(PermIter *const it)
+{
+    free(it->index);
+    *it = (PermIter){0};
+}
+
+bool plain_init(PlainIter *const it, const int count)
+{
+    *it = (PlainIter){0};
+    if (count < 1)
+        return false;
+    it->perm = malloc((size_t)(3 * count + 2) * sizeof *it->perm);
+    if (!it->perm)
+        return false;
+    it->c = it->perm + count;
+    it->o = it->c + count + 1;
+    it->count = count;
+    return plain_seek(it, 0);
+}
+
+// Level j (1-based) moves value j-1 through the values 0..j-2. With r_n = rank
+// and r_(j-1) = r_j / j, sweep number r_(j-1) is leftwards when even, and
+// r_j % j is the number of moves made in the current sweep. Algorithm P calls
+// that number c[j] when going left, j-1-c[j] when going right.
+static void plain_state(uint64_t rank, const int count, int *const c, int *const o)
+{
+    for (int j = count; j >= 1; --j) {
+        const uint64_t q = rank / (uint64_t)j;
+        const int p = (int)(rank % (uint64_t)j);
+        o[j] = q & 1 ? -1 : 1;
+        c[j] = q & 1 ? j - 1 - p : p;
+        rank = q;
+    }
+}
+
+// Insert value j-1 at position j-1-c[j] among values 0..j-2
+static void plain_build(const int count, const int *const c, int *const perm)
+{
+    for (int j = 1; j <= count; ++j) {
+        const int at = j - 1 - c[j];
+        memmove(&perm[at + 1], &perm[at], (size_t)(j - 1 - at) * sizeof *perm);
+        perm[at] = j - 1;
+    }
+}
+
+uint64_t plain_rank(const int *const perm, const int count)
+{
+    // Position of each value in the permutation
+    int *pos = malloc((size_t)count * sizeof *pos);
+    if (!pos)
+        return UINT64_MAX;
+    for (int i = 0; i < count; ++i)
+        pos[perm[i]] = i;
+    uint64_t rank = 0;
+    for (int j = 1; j <= count; ++j) {
+        // Position of value j-1 among values 0..j-1 = number of smaller values to the left
+        int at = 0;
+        for (int v = 0; v < j - 1; ++v)
+            at += pos[v] < pos[j - 1];
+        const int c = j - 1 - at;
+        rank = rank * (uint64_t)j + (uint64_t)(rank & 1 ? j - 1 - c : c);
+    }
+    free(pos);
+    return rank;
+}
+
+bool plain_unrank(const uint64_t rank, const int count, int *const perm)
+{
+    if (count < 1)
+        return false;
+    int *c = malloc((size_t)(2 * count + 2) * sizeof *c);
+    if (!c)
+        return false;
+    plain_state(rank, count, c, c + count + 1);
+    plain_build(count, c, perm);
+    free(c);
+    return true;
+}
+
+bool plain_seek(PlainIter *const it, const uint64_t rank)
+{
+    if (!it->perm || rank >= perm_count(it->count))
+        return false;
+    plain_state(rank, it->count, it->c, it->o);
+    plain_build(it->count, it->c, it->perm);
+    it->fresh = true;
+    it->done = false;
+    return true;
+}
+
+bool door_init(DoorIter *const it, const int n, const int k)
+{
+    *it = (DoorIter){0};
+    if (n <= 0 || k <= 0 || n <= k)
+        return false;
+    it->index = malloc((size_t)(k + 1) * sizeof *it->index);
+    if (!it->index)
+        return false;
+    for (int i = 0; i < k; ++i)
+        it->index[i] = i;
+    it->index[k] = n;  // sentinel c[t+1]
+    it->n = n;
+    it->k = k;
+    it->out = it->in = -1;
+    it->fresh = true;
+    return true;
+}
+
+// Knuth 4A, §7.2.1.3, algorithm R, steps R3-R6. With 1-based c[j] = index[j-1].
+int *door_next(DoorIter *const it)
+{
+    if (!it->index || it->done)
+        return NULL;
+    int *const c = it->index - 1;
+    const int t = it->k;
+    if (it->fresh) {
+        it->fresh = false;
+        return it->index;
+    }
+    int j = 2;
+    // R3: easy case
+    if (t & 1) {
+        if (c[1] + 1 < c[2]) {
+            it->out = c[1]++;
+            it->in = c[1];
+            return it->index;
+        }
+        goto door_r4;
+    }
+    if (c[1] > 0) {
+        it->out = c[1]--;
+        it->in = c[1];
+        return it->index;
+    }
+    goto door_r5;
+
+door_r4:  // try to decrease c[j], where c[j] = c[j-1] + 1
+    if (j > t)
+        goto door_r6;
+    if (c[j] >= j) {
+        it->out = c[j];
+        it->in = j - 2;
+        c[j] = c[j - 1];
+        c[j - 1] = j - 2;
+        return it->index;
+    }
+    ++j;
+door_r5:  // try to increase c[j], where c[j-1] = j-2
+    if (j > t)
+        goto door_r6;
+    if (c[j] + 1 < c[j + 1]) {
+        it->out = c[j - 1];
+        c[j - 1] = c[j];
+        it->in = ++c[j];
+        return it->index;
+    }
+    ++j;
+    goto door_r4;
+
+door_r6:  // all combinations visited
+    it->done = true;
+    return NULL;
+}
+
+// Revolving-door order of k from n is: all combinations of k from n-1, then
+// those of k-1 from n-1 in reverse order, each with n-1 added.
+uint64_t door_rank(const int *const index, const int k)
+{
+    uint64_t rank = 0;
+    for (int i = 0; i < k; ++i)
+        rank = comb_count(index[i] + 1, i + 1) - 1 - rank;
+    return rank;
+}
+
+void door_unrank(uint64_t rank, const int n, const int k, int *const index)
+{
+    int c = n;
+    for (int i = k - 1; i >= 0; --i) {
+        uint64_t b;
+        do
+            b = comb_count(--c, i + 1);
+        while (b > rank);
+        index[i] = c;
+        rank = comb_count(c + 1, i + 1) - 1 - rank;  // reversed inside this block
+    }
+}
+
+bool door_seek(DoorIter *const it, const uint64_t rank)
+{
+    if (!it->index || rank >= comb_count(it->n, it->k))
+        return false;
+    door_unrank(rank, it->n, it->k, it->index);
+    it->out = it->in = -1;
+    it->fresh = true;
+    it->done = false;
+    return true;
+}
+
+void door_free(DoorIter *const it)
+{
+    free(it->index);
+    *it = (DoorIter){0};
+}
+
+// Divide ranks [0..total) into 'parts' contiguous chunks of (nearly) equal size.
+// Sets chunk number 'part' (0-based) as [*beg..*end).
+void combperm_chunk(const uint64_t total, const int parts, const int part,
+                    uint64_t *const beg, uint64_t *const end)
+{
+    const uint64_t size = total / (uint64_t)parts;
+    const uint64_t rest = total % (uint64_t)parts;  // first 'rest' chunks get one extra
+    const uint64_t p = (uint64_t)part;
+    *beg = p * size + (p < rest ? p : rest);
+    *end = *beg + size + (p < rest);
+}
+
+// Knuth 4A, §7.2.1.2, algorithm P, steps P3-P7.
+int *plain_next(PlainIter *const it)
+{
+    if (!it->perm || it->done)
+        return NULL;
+    int *const a = it->perm - 1;  // algorithm P is 1-based
+    int *const c = it->c, *const o = it->o;
+    if (it->fresh) {
+        it->fresh = false;
+        return it->perm;
+    }
+    int j = it->count, s = 0;
+    for (;;) {
+        const int q = c[j] + o[j];
+        if (q >= 0) {
+            if (q != j) {
+                swap(&a[j - c[j] + s], &a[j - q + s]);
+                c[j] = q;
+                return it->perm;
+            }
+            if (j == 1) {
+                it->done = true;
+                return NULL;
+            }
+            ++s;
+        }
+        o[j] = -o[j];
+        --j;
+    }
+}
+
+void plain_free(PlainIter *const it)
+{
+    free(it->perm);
+    *it = (PlainIter){0};
+}
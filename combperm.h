@@ -9,11 +9,15 @@
 #ifndef COMBPERM_H
 #define COMBPERM_H
 
+#include <stdint.h>   // uint64_t
+#include <stdbool.h>  // bool
+
 // Successive calls give combinations of k indices from a set of n.
 // Adapted from Knuth 4A, §7.2.1.3, algorithm T.
 // Returns pointer to array of int, index 0..k-1.
 // For example: combinations(3,2) gives [0,1], [0,2], [1,2]
 // Call as combinations(0,0) to reset and free memory.
+//   NB: not thread-safe, see CombIter.
 extern int *combinations(const int n, const int k);
 
 // Successive calls give permutations in lexicographic order of 'count' index numbers.
@@ -22,7 +26,7 @@ extern int *combinations(const int n, const int k);
 // Returns NULL (and memory is freed) when all permutations have been visited.
 //   Set count<=0 to free memory.
 //   NB: not thread-safe because permutation and state
-//       are stored in local static variables.
+//       are stored in local static variables, see PermIter.
 extern int *permutations(const int count);
 
 // Successive calls give permutations in "plain changes" order of 'count' index numbers.
@@ -34,7 +38,140 @@ extern int *permutations(const int count);
 // Returns NULL (but memory NOT freed) when all permutations have been visited.
 //   Set count<=0 to free memory.
 //   NB: not thread-safe because permutation and state
-//       are stored in local static variables.
+//       are stored in local static variables, see PlainIter.
 extern int *plainchanges(const int count);
 
+// Reentrant versions of the generators above. All state is in an iterator
+// struct owned by the caller, so every thread can walk its own sequence.
+// Usage:
+//   CombIter it;
+//   if (comb_init(&it, n, k))
+//       for (int *index; (index = comb_next(&it)); ) { ... }
+//   comb_free(&it);
+// The first call of *_next() after *_init() or *_seek() returns the
+// permutation/combination at that rank, subsequent calls step forward.
+// *_next() returns NULL after the last one; memory is only freed by *_free().
+
+// Combinations of k indices from a set of n, same order as combinations().
+typedef struct combiter {
+    int n, k, j;     // Knuth algorithm T state
+    bool fresh;      // next call returns current combination without stepping
+    bool done;       // all combinations have been visited
+    int *index;      // k+2 ints, first k are the combination
+} CombIter;
+
+// Permutations of 'count' index numbers, lexicographic order as permutations().
+typedef struct permiter {
+    int count;
+    bool fresh;
+    int *index;  // count ints
+} PermIter;
+
+// Permutations of 'count' index numbers in "plain changes" order, same order
+// as plainchanges(). Uses Knuth 4A, §7.2.1.2, algorithm P which, unlike the
+// Even variant, has state that can be derived directly from a rank.
+typedef struct plainiter {
+    int count;
+    bool fresh, done;
+    int *perm;   // count ints: permutation
+    int *c, *o;  // count+1 ints each: algorithm P state, index 1..count
+} PlainIter;
+
+// Allocate and set to first combination, return false on wrong input (need 0<k<n) or no memory.
+extern bool comb_init(CombIter *const it, const int n, const int k);
+// Next combination, or NULL when all have been visited.
+extern int *comb_next(CombIter *const it);
+// Jump to combination at 0-based rank, return false if rank out of range.
+extern bool comb_seek(CombIter *const it, const uint64_t rank);
+// Free memory.
+extern void comb_free(CombIter *const it);
+
+// Allocate and set to first permutation, return false on wrong input (need count>0) or no memory.
+extern bool perm_init(PermIter *const it, const int count);
+// Next permutation, or NULL when all have been visited.
+extern int *perm_next(PermIter *const it);
+// Jump to permutation at 0-based rank, return false if rank out of range.
+extern bool perm_seek(PermIter *const it, const uint64_t rank);
+// Free memory.
+extern void perm_free(PermIter *const it);
+
+// Allocate and set to first permutation, return false on wrong input (need count>0) or no memory.
+extern bool plain_init(PlainIter *const it, const int count);
+// Next permutation, or NULL when all have been visited.
+extern int *plain_next(PlainIter *const it);
+// Jump to permutation at 0-based rank, return false if rank out of range.
+extern bool plain_seek(PlainIter *const it, const uint64_t rank);
+// Free memory.
+extern void plain_free(PlainIter *const it);
+
+// Combinations of k indices from a set of n in revolving-door order: every
+// combination differs from the previous one by exactly one element, so
+// callers can update a running sum or product in O(1) per step.
+// Ref.: Knuth 4A, §7.2.1.3, algorithm R.
+// Usage:
+//   DoorIter it;
+//   if (door_init(&it, n, k))
+//       for (int *index; (index = door_next(&it)); )
+//           if (it.out >= 0) sum += weight[it.in] - weight[it.out];
+//   door_free(&it);
+// The first call of door_next() returns [0,1,..,k-1] with out = in = -1.
+// The index array is always sorted ascending.
+typedef struct dooriter {
+    int n, k;
+    int out, in;      // element removed from and added to previous combination
+    bool fresh, done;
+    int *index;       // k+1 ints, first k are the combination
+} DoorIter;
+
+// Allocate and set to first combination, return false on wrong input (need 0<k<n) or no memory.
+extern bool door_init(DoorIter *const it, const int n, const int k);
+// Next combination, or NULL when all have been visited; sets it->out and it->in.
+extern int *door_next(DoorIter *const it);
+// Jump to combination at 0-based rank, return false if rank out of range.
+// The first call of door_next() after this has out = in = -1.
+extern bool door_seek(DoorIter *const it, const uint64_t rank);
+// Free memory.
+extern void door_free(DoorIter *const it);
+
+// Ranking and unranking: the 0-based position of a combination or
+// permutation in the order of the generators above, and vice versa.
+// Together with combperm_chunk() and *_seek(), every thread can enumerate
+// its own contiguous slice of the sequence without coordination.
+
+// Number of combinations of k from n, or 0 if out of range (saturates at UINT64_MAX).
+extern uint64_t comb_count(const int n, int k);
+// Number of permutations of n = n! (saturates at UINT64_MAX from n=21).
+extern uint64_t perm_count(const int n);
+
+// Rank of combination index[0..k-1] in colex order of combinations()/CombIter.
+extern uint64_t comb_rank(const int *const index, const int k);
+// Combination of k from n at rank, stored in index[0..k-1].
+extern void comb_unrank(uint64_t rank, const int n, const int k, int *const index);
+
+// Rank of permutation index[0..count-1] in lexicographic order of permutations()/PermIter.
+extern uint64_t perm_rank(const int *const index, const int count);
+// Permutation at rank in lexicographic order, stored in index[0..count-1].
+extern void perm_unrank(uint64_t rank, const int count, int *const index);
+
+// Rank of permutation in plain changes order of plainchanges()/PlainIter.
+// Returns UINT64_MAX if out of memory.
+extern uint64_t plain_rank(const int *const perm, const int count);
+// Permutation at rank in plain changes order, stored in perm[0..count-1].
+// Returns false on wrong input (need count>0) or no memory, perm is then unchanged.
+extern bool plain_unrank(const uint64_t rank, const int count, int *const perm);
+
+// Rank of combination index[0..k-1] in revolving-door order of DoorIter.
+extern uint64_t door_rank(const int *const index, const int k);
+// Combination of k from n at rank in revolving-door order, stored in index[0..k-1].
+extern void door_unrank(uint64_t rank, const int n, const int k, int *const index);
+
+// Divide ranks [0..total) into 'parts' contiguous chunks of (nearly) equal size.
+// Sets chunk number 'part' (0-based) as [*beg..*end).
+// Usage, e.g. in thread number 'part':
+//   combperm_chunk(perm_count(n), threads, part, &beg, &end);
+//   perm_seek(&it, beg);
+//   for (uint64_t r = beg; r < end; ++r) { int *p = perm_next(&it); ... }
+extern void combperm_chunk(const uint64_t total, const int parts, const int part,
+                           uint64_t *const beg, uint64_t *const end);
+
 #endif // COMBPERM_H
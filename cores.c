@@ -0,0 +1,26 @@
+#if __APPLE__
+    #include <sys/sysctl.h>  // sysctlbyname
+#elif __linux__
+    #define _GNU_SOURCE  // must come before all includes, not just sched.h
+    #include <sched.h>   // sched_getaffinity
+#endif
+#include <stdlib.h>  // atoi, getenv
+#include "cores.h"
+
+int coresavail(const int lo, const int hi)
+{
+    int n = 0;
+    #if __APPLE__
+        size_t size = sizeof n;
+        sysctlbyname("hw.activecpu", &n, &size, NULL, 0);
+    #elif __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        sched_getaffinity(0, sizeof set, &set);
+        n = CPU_COUNT(&set);
+    #elif _WIN32
+        const char *env = getenv("NUMBER_OF_PROCESSORS");
+        n = env ? atoi(env) : 1;
+    #endif
+    return n < lo ? lo : (n > hi ? hi : n);
+}
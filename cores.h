@@ -0,0 +1,20 @@
+/**
+ * AVAILABLE CPU CORES
+ * Number of cores this program may run on, to size a pool of worker threads.
+ * Freeware. No pull requests accepted.
+ * https://github.com/ednl
+ *
+ * Usage:
+ *     const int threads = coresavail(1, MAXTHREADS);
+ * Compile:
+ *     cc -std=c17 -Wall -Wextra -pedantic ../cores.c 15.c -lpthread
+ */
+
+#ifndef CORES_H
+#define CORES_H
+
+// Number of CPU cores available to this program.
+// Return: value between lo and hi, inclusive.
+int coresavail(const int lo, const int hi);
+
+#endif  // CORES_H
@@ -0,0 +1,99 @@
+/**
+ * PARALLEL MD5 NONCE SEARCH
+ * Find the lowest index whose md5(prefix + decimal index) satisfies a predicate.
+ * Freeware. No pull requests accepted.
+ * https://github.com/ednl
+ *
+ * Worker threads claim contiguous chunks of indices from a shared counter,
+ * so every thread keeps its own salted counter message (see mymd5_salt_init)
+ * and only increments it. A match lowers the shared best index; chunks that start beyond the
+ * best are never started, but chunks below it run to completion. That way
+ * the result is always the lowest match, independent of thread timing.
+ */
+
+#include <string.h>     // memcpy
+#include <stdatomic.h>  // atomic_uint_fast64_t
+#include <pthread.h>    // pthread_create, pthread_join
+#include "mymd5.h"
+#include "md5mine.h"
+#include "cores.h"
+
+// Indices per claimed chunk: big enough to make the atomic counter cheap,
+// small enough to not overshoot much past the match.
+#define CHUNK (MYMD5_MAXLANES * 256)
+
+typedef struct mine {
+    const char *prefix;
+    Md5Match match;
+    const void *arg;
+    atomic_uint_fast64_t next;  // start of next unclaimed chunk
+    atomic_uint_fast64_t best;  // lowest match so far
+    uint32_t digest[4];         // digest of best match
+    pthread_mutex_t lock;       // protects digest
+} Mine;
+
+int md5mine_cores(void)
+{
+    return coresavail(1, MD5MINE_MAXTHREADS);
+}
+
+// Record match if it is lower than the best so far
+static void found(Mine * const mine, const uint64_t index, const uint32_t * const digest)
+{
+    pthread_mutex_lock(&mine->lock);
+    if (index < atomic_load(&mine->best)) {
+        atomic_store(&mine->best, index);
+        memcpy(mine->digest, digest, sizeof mine->digest);
+    }
+    pthread_mutex_unlock(&mine->lock);
+}
+
+// Parallel execution in separate threads.
+static void *worker(void *arg)
+{
+    Mine *mine = arg;
+    Md5Salt ctx;
+    uint32_t sum[MYMD5_MAXLANES][4];
+
+    for (;;) {
+        const uint64_t beg = atomic_fetch_add(&mine->next, CHUNK);
+        if (beg >= atomic_load(&mine->best))
+            break;  // any match in this chunk would not be the lowest
+
+        // Render chunk start once, then only increment
+        mymd5_salt_init(&ctx, mine->prefix, beg);
+        for (uint64_t base = beg; base < beg + CHUNK; base += MYMD5_MAXLANES) {
+            mymd5_salt_batch(&ctx, sum, MYMD5_MAXLANES);
+            for (int i = 0; i < MYMD5_MAXLANES; ++i)
+                if (mine->match(sum[i], mine->arg)) {
+                    found(mine, base + (uint64_t)i, sum[i]);
+                    return NULL;  // later chunks can only have higher indices
+                }
+            if (base >= atomic_load(&mine->best))
+                break;  // lower match found elsewhere, abandon chunk
+        }
+    }
+    return NULL;
+}
+
+uint64_t md5mine(const char * const prefix, const uint64_t start,
+                 Md5Match match, const void * const arg,
+                 const int threads, uint32_t * const digest)
+{
+    pthread_t tid[MD5MINE_MAXTHREADS];
+    Mine mine = {
+        .prefix = prefix,
+        .match = match, .arg = arg,
+        .next = start, .best = UINT64_MAX,
+        .lock = PTHREAD_MUTEX_INITIALIZER
+    };
+    const int n = threads <= 0 ? md5mine_cores()
+        : (threads > MD5MINE_MAXTHREADS ? MD5MINE_MAXTHREADS : threads);
+    for (int i = 0; i < n; ++i)
+        pthread_create(&tid[i], NULL, worker, &mine);
+    for (int i = 0; i < n; ++i)
+        pthread_join(tid[i], NULL);
+    if (digest)
+        memcpy(digest, mine.digest, sizeof mine.digest);
+    return atomic_load(&mine.best);
+}
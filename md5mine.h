@@ -0,0 +1,35 @@
+/**
+ * PARALLEL MD5 NONCE SEARCH
+ * Find the lowest index whose md5(prefix + decimal index) satisfies a predicate.
+ * Freeware. No pull requests accepted.
+ * https://github.com/ednl
+ */
+
+#ifndef MD5MINE_H
+#define MD5MINE_H
+
+#include <stdint.h>   // uint32_t, uint64_t
+#include <stdbool.h>  // bool
+#include "mymd5.h"    // MYMD5_MAXSALT
+
+// Arbitrary limit to avoid dynamic allocation of thread arrays.
+#define MD5MINE_MAXTHREADS 64
+
+// Predicate on binary md5 digest (four 32-bit words a0,b0,c0,d0, see mymd5_batch)
+//   arg is passed unchanged from md5mine()
+//   NB: called concurrently from all worker threads, so must not modify shared state
+typedef bool (*Md5Match)(const uint32_t * const digest, const void * const arg);
+
+// Number of CPU cores available to this program, clamped to [1..MD5MINE_MAXTHREADS]
+int md5mine_cores(void);
+
+// Lowest index >= start where md5(prefix + index in decimal) satisfies match
+//   prefix must be null terminated string with strlen <= MYMD5_MAXSALT
+//   threads <= 0: use all available cores
+//   digest: if not NULL, receives the binary md5 digest of the match
+// Search does not stop until a match is found.
+uint64_t md5mine(const char * const prefix, const uint64_t start,
+                 Md5Match match, const void * const arg,
+                 const int threads, uint32_t * const digest);
+
+#endif  // MD5MINE_H
@@ -1,41 +1,112 @@
 #include <stdio.h>    // fputs, size_t
 #include <stdint.h>   // uint8_t, uint32_t, uint64_t
 #include <stdbool.h>  // bool, false, true
+#include <string.h>   // memcpy
 #include "mymd5.h"
 
+// GCC/Clang vector extensions compile to SSE2/AVX2/AVX-512 on x86 and to
+// NEON on ARM, so the same lane-parallel kernel serves every instruction set.
+#if defined(__GNUC__) || defined(__clang__)
+    #define MYMD5_VECTOR 1
+    #if defined(__x86_64__) || defined(__i386__)
+        #define MYMD5_X86 1
+    #endif
+#endif
+
+static const uint32_t rot[64] = {
+    7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,
+    5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,
+    4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,
+    6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21};
+
+static const uint32_t K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+    0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+    0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+    0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+    0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+    0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+// a0, b0, c0, d0
+static const uint32_t init[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
 // Single hex character from value [0..15], hopefully fast
 static char hexc(const uint8_t val)
 {
     return "0123456789abcdef"[val];
 }
 
-void mymd5(const char * const message, char * const digest)
+// Break 512-bit chunk into sixteen 32-bit words M[j] (little-endian)
+static void words(const uint8_t * const chunk, uint32_t * const M)
+{
+    for (int j = 0; j < 16; ++j) {
+        int k = j << 2;  // j * 4
+        M[j] = (uint32_t)chunk[k + 3] << 24  // high to low prec: cast, shift, or
+             | (uint32_t)chunk[k + 2] << 16
+             | (uint32_t)chunk[k + 1] <<  8
+             | (uint32_t)chunk[k];
+    }
+}
+
+// Run md5 steps [from..to) on state A,B,C,D for one chunk of sixteen 32-bit words
+static void md5steps(uint32_t * const abcd, const uint32_t * const M, const int from, const int to)
+{
+    uint32_t A = abcd[0], B = abcd[1], C = abcd[2], D = abcd[3];
+    for (uint32_t i = (uint32_t)from; i < (uint32_t)to; ++i) {
+        uint32_t F, g;
+        switch (i >> 4) {
+            case 0:
+                F = D ^ (B & (C ^ D));
+                g = i;
+                break;
+            case 1:
+                F = C ^ (D & (B ^ C));
+                g = (i * 5 + 1) & 0xf;
+                break;
+            case 2:
+                F = B ^ C ^ D;
+                g = (i * 3 + 5) & 0xf;
+                break;
+            default:
+                F = C ^ (B | ~D);
+                g = (i * 7) & 0xf;
+                break;
+        }
+        F += A + K[i] + M[g];
+        A = D;
+        D = C;
+        C = B;
+        B += F << rot[i] | F >> (32 - rot[i]);
+    }
+    abcd[0] = A;
+    abcd[1] = B;
+    abcd[2] = C;
+    abcd[3] = D;
+}
+
+// Add one 512-bit chunk (as sixteen 32-bit words) to running sum
+static void md5chunk(uint32_t * const sum, const uint32_t * const M)
+{
+    uint32_t abcd[4] = {sum[0], sum[1], sum[2], sum[3]};
+    md5steps(abcd, M, 0, 64);
+    for (int i = 0; i < 4; ++i)
+        sum[i] += abcd[i];
+}
+
+// Binary md5 digest of message of any length
+static void md5sum(const char * const message, uint32_t * const sum)
 {
-    static const uint32_t rot[64] = {
-        7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,  7, 12, 17, 22,
-        5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,  5,  9, 14, 20,
-        4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,  4, 11, 16, 23,
-        6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21,  6, 10, 15, 21};
-    static const uint32_t K[64] = {
-        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
-        0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
-        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
-        0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
-        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
-        0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
-        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
-        0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
-        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
-        0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
-        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
-        0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
-        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
-        0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
-        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
-        0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
-
-    // a0, b0, c0, d0
-    uint32_t sum[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    memcpy(sum, init, sizeof init);
 
     uint64_t msglen = 0;  // message length in bytes (later in bits mod 2^64)
     const char *c = message;
@@ -69,63 +140,42 @@ void mymd5(const char * const message, char * const digest)
             }
         }
 
-        // Break 512-bit message into sixteen 32-bit words M[j]
         uint32_t M[16];
-        for (int j = 0; j < 16; ++j) {
-            int k = j << 2;  // j * 4
-            M[j] = (uint32_t)chunk[k + 3] << 24  // high to low prec: cast, shift, or
-                 | (uint32_t)chunk[k + 2] << 16
-                 | (uint32_t)chunk[k + 1] <<  8
-                 | (uint32_t)chunk[k];
-        }
-
-        uint32_t A = sum[0], B = sum[1], C = sum[2], D = sum[3];
-        for (uint32_t i = 0; i < 64; ++i) {
-            uint32_t F, g;
-            switch (i >> 4) {
-                case 0:
-                    F = D ^ (B & (C ^ D));
-                    g = i;
-                    break;
-                case 1:
-                    F = C ^ (D & (B ^ C));
-                    g = (i * 5 + 1) & 0xf;
-                    break;
-                case 2:
-                    F = B ^ C ^ D;
-                    g = (i * 3 + 5) & 0xf;
-                    break;
-                default:
-                    F = C ^ (B | ~D);
-                    g = (i * 7) & 0xf;
-                    break;
-            }
-            F += A + K[i] + M[g];
-            A = D;
-            D = C;
-            C = B;
-            B += F << rot[i] | F >> (32 - rot[i]);
-        }
-        sum[0] += A;
-        sum[1] += B;
-        sum[2] += C;
-        sum[3] += D;
+        words(chunk, M);
+        md5chunk(sum, M);
     }
+}
 
+void mymd5(const char * const message, char * const digest)
+{
+    uint32_t sum[4];
+    md5sum(message, sum);
+    mymd5_hex(sum, digest);
+}
+
+void mymd5_hex(const uint32_t * const sum, char * const digest)
+{
     // Save hex digest[0..31]
     char *d = digest;
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < 4; ++i) {
+        uint32_t x = sum[i];
         for (int j = 0; j < 4; ++j) {
-            *d++ = hexc(sum[i] >> 4 & 0xf);  // high to low prec: shift, and
-            *d++ = hexc(sum[i]      & 0xf);
-            sum[i] >>= 8;
+            *d++ = hexc(x >> 4 & 0xf);  // high to low prec: shift, and
+            *d++ = hexc(x      & 0xf);
+            x >>= 8;
         }
+    }
     *d = '\0';  // digest[32] = NUL
 }
 
 char * mymd5_tostr(const char * const message)
 {
     static char digest[64];
+    return mymd5_tostr_r(message, digest);
+}
+
+char * mymd5_tostr_r(const char * const message, char * const digest)
+{
     mymd5(message, digest);
     return digest;
 }
@@ -145,3 +195,280 @@ void mymd5_stretch(char * const message, const int n)
     for (int i = 0; i < n; ++i)
         mymd5(message, message);
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Batch API: many short messages in parallel, one message per SIMD lane.
+// Words are stored "structure of arrays": M[j][lane] and sum[i][lane].
+////////////////////////////////////////////////////////////////////////////////
+
+// Single-chunk messages M, starting at step 'from' with state abcd (which
+// is the initial state a0,b0,c0,d0 when from=0) and hashing only the first
+// 'used' lanes, or rounded up to the kernel width.
+typedef void (*Kernel)(uint32_t (*M)[MYMD5_MAXLANES], uint32_t (*sum)[MYMD5_MAXLANES], const int used,
+                       const uint32_t * const abcd, const int from);
+
+// Scalar fallback: one lane at a time
+static void kernel1(uint32_t (*M)[MYMD5_MAXLANES], uint32_t (*sum)[MYMD5_MAXLANES], const int used,
+                    const uint32_t * const abcd, const int from)
+{
+    uint32_t m[16], s[4];
+    for (int lane = 0; lane < used; ++lane) {
+        for (int j = 0; j < 16; ++j)
+            m[j] = M[j][lane];
+        memcpy(s, abcd, sizeof s);
+        md5steps(s, m, from, 64);
+        for (int i = 0; i < 4; ++i)
+            sum[i][lane] = s[i] + init[i];
+    }
+}
+
+#ifdef MYMD5_VECTOR
+// One md5 step on all lanes, with round function FUN and message word MSG
+#define MYMD5_STEP(FUN, MSG) do { \
+    vec F = (FUN) + A + K[i] + (MSG); \
+    A = D; \
+    D = C; \
+    C = B; \
+    B += F << rot[i] | F >> (32 - rot[i]); \
+} while (0)
+
+// Same algorithm as md5steps() but for LANES messages at once. One loop per
+// round so the round function and message index need no switch.
+#define MYMD5_KERNEL(NAME, LANES) \
+static void NAME(uint32_t (*M)[MYMD5_MAXLANES], uint32_t (*sum)[MYMD5_MAXLANES], const int used, \
+                 const uint32_t * const abcd, const int from) \
+{ \
+    typedef uint32_t vec __attribute__((vector_size(LANES * sizeof (uint32_t)))); \
+    for (int base = 0; base < used; base += LANES) { \
+        vec m[16]; \
+        for (int j = 0; j < 16; ++j) \
+            memcpy(&m[j], &M[j][base], sizeof (vec)); \
+        vec A = abcd[0] + (vec){0}, B = abcd[1] + (vec){0}; \
+        vec C = abcd[2] + (vec){0}, D = abcd[3] + (vec){0}; \
+        uint32_t i = (uint32_t)from, g; \
+        for (; i < 16; ++i) \
+            MYMD5_STEP(D ^ (B & (C ^ D)), m[i]); \
+        for (g = 1; i < 32; ++i, g += 5) \
+            MYMD5_STEP(C ^ (D & (B ^ C)), m[g & 0xf]); \
+        for (g = 5; i < 48; ++i, g += 3) \
+            MYMD5_STEP(B ^ C ^ D, m[g & 0xf]); \
+        for (g = 0; i < 64; ++i, g += 7) \
+            MYMD5_STEP(C ^ (B | ~D), m[g & 0xf]); \
+        A += init[0]; B += init[1]; C += init[2]; D += init[3]; \
+        memcpy(&sum[0][base], &A, sizeof (vec)); \
+        memcpy(&sum[1][base], &B, sizeof (vec)); \
+        memcpy(&sum[2][base], &C, sizeof (vec)); \
+        memcpy(&sum[3][base], &D, sizeof (vec)); \
+    } \
+}
+
+MYMD5_KERNEL(kernel4, 4)  // SSE2 on x86-64, NEON on ARM64
+
+#ifdef MYMD5_X86
+__attribute__((target("avx2")))    MYMD5_KERNEL(kernel8, 8)
+__attribute__((target("avx512f"))) MYMD5_KERNEL(kernel16, 16)
+#endif
+#endif  // MYMD5_VECTOR
+
+// Scalar fallback until (or unless) a SIMD kernel is selected at startup.
+// Only written before main() runs, so safe to read from any thread.
+static Kernel kernel = kernel1;
+static int lanes = 1;
+
+#ifdef MYMD5_VECTOR
+// Select fastest kernel supported by this CPU, once at program startup
+__attribute__((constructor))
+static void selectkernel(void)
+{
+    kernel = kernel4;
+    lanes = 4;
+#ifdef MYMD5_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        kernel = kernel16;
+        lanes = 16;
+    } else if (__builtin_cpu_supports("avx2")) {
+        kernel = kernel8;
+        lanes = 8;
+    }
+#endif
+}
+#endif
+
+int mymd5_lanes(void)
+{
+    return lanes;
+}
+
+void mymd5_batch(const char * const * const messages, uint32_t (* const digest)[4], const size_t count)
+{
+    uint32_t M[16][MYMD5_MAXLANES], sum[4][MYMD5_MAXLANES];
+    size_t lane[MYMD5_MAXLANES];  // which message is in which lane
+    size_t i = 0;
+    while (i < count) {
+        int used = 0;
+        for (; i < count && used < MYMD5_MAXLANES; ++i) {
+            const char *s = messages[i];
+            size_t len = 0;
+            uint8_t chunk[64] = {0};
+            while (len < 56 && s[len]) {
+                chunk[len] = (uint8_t)s[len];
+                ++len;
+            }
+            if (len > 55) {  // does not fit in one chunk with padding and length
+                md5sum(s, digest[i]);
+                continue;
+            }
+            chunk[len] = 0x80;
+            chunk[56] = (uint8_t)(len << 3);
+            chunk[57] = (uint8_t)(len >> 5);
+            uint32_t m[16];
+            words(chunk, m);
+            for (int j = 0; j < 16; ++j)
+                M[j][used] = m[j];
+            lane[used++] = i;
+        }
+        if (!used)
+            continue;
+        for (int k = used; k < MYMD5_MAXLANES; ++k)  // unused lanes: keep vector loads defined
+            for (int j = 0; j < 16; ++j)
+                M[j][k] = M[j][0];
+        kernel(M, sum, used, init, 0);  // vector kernels round up to their own width
+        for (int k = 0; k < used; ++k)
+            for (int j = 0; j < 4; ++j)
+                digest[lane[k]][j] = sum[j][k];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Salted counter: message = fixed salt + incrementing decimal number.
+// Salt-only message words and the round 1 steps that use only those words
+// are computed once; incrementing the counter touches only the last digits.
+////////////////////////////////////////////////////////////////////////////////
+
+// Re-read message words [from..to) from chunk
+static void salt_words(Md5Salt * const ctx, const int from, const int to)
+{
+    for (int j = from; j < to; ++j) {
+        const uint8_t *const c = &ctx->chunk[j << 2];
+        ctx->M[j] = (uint32_t)c[3] << 24 | (uint32_t)c[2] << 16 | (uint32_t)c[1] << 8 | (uint32_t)c[0];
+    }
+}
+
+// Render counter after salt, pad and set length
+static void salt_render(Md5Salt * const ctx)
+{
+    char buf[24];
+    int digits = 0;
+    uint64_t x = ctx->index;
+    do {
+        buf[digits++] = '0' | (char)(x % 10);
+        x /= 10;
+    } while (x);
+    ctx->len = ctx->saltlen;
+    while (digits)
+        ctx->chunk[ctx->len++] = (uint8_t)buf[--digits];
+    memset(ctx->chunk + ctx->len, 0, sizeof ctx->chunk - ctx->len);
+    ctx->chunk[ctx->len] = 0x80;
+    ctx->chunk[56] = (uint8_t)(ctx->len << 3);
+    ctx->chunk[57] = (uint8_t)(ctx->len >> 5);
+    salt_words(ctx, ctx->steps, 16);
+}
+
+void mymd5_salt_init(Md5Salt * const ctx, const char * const salt, const uint64_t start)
+{
+    size_t n = 0;
+    while (n < MYMD5_MAXSALT && salt[n]) {
+        ctx->chunk[n] = (uint8_t)salt[n];
+        ++n;
+    }
+    ctx->saltlen = n;
+    ctx->steps = 0;
+    ctx->index = start;
+    salt_render(ctx);
+    // Round 1 uses M[0..15] in order, so steps with whole salt words are fixed
+    ctx->steps = (int)(n >> 2);
+    memcpy(ctx->abcd, init, sizeof init);
+    md5steps(ctx->abcd, ctx->M, 0, ctx->steps);
+}
+
+void mymd5_salt_next(Md5Salt * const ctx)
+{
+    ctx->index++;
+    uint8_t *c = &ctx->chunk[ctx->len - 1];  // least significant digit
+    while (*c == '9' && c > &ctx->chunk[ctx->saltlen])  // cascade through nines
+        *c-- = '0';
+    if (*c == '9') {  // all nines: new digit
+        salt_render(ctx);
+        return;
+    }
+    ++*c;
+    // Only words from the most significant changed digit up to the last digit
+    salt_words(ctx, (int)((size_t)(c - ctx->chunk) >> 2), (int)((ctx->len - 1) >> 2) + 1);
+}
+
+void mymd5_salt_sum(const Md5Salt * const ctx, uint32_t * const sum)
+{
+    memcpy(sum, ctx->abcd, sizeof ctx->abcd);
+    md5steps(sum, ctx->M, ctx->steps, 64);
+    for (int i = 0; i < 4; ++i)
+        sum[i] += init[i];
+}
+
+void mymd5_salt_batch(Md5Salt * const ctx, uint32_t (* const digest)[4], const size_t count)
+{
+    uint32_t M[16][MYMD5_MAXLANES], sum[4][MYMD5_MAXLANES];
+    size_t i = 0;
+    while (i < count) {
+        const int used = count - i < MYMD5_MAXLANES ? (int)(count - i) : MYMD5_MAXLANES;
+        for (int k = 0; k < MYMD5_MAXLANES; ++k) {
+            for (int j = 0; j < 16; ++j)
+                M[j][k] = ctx->M[j];
+            if (k < used)
+                mymd5_salt_next(ctx);
+        }
+        kernel(M, sum, used, ctx->abcd, ctx->steps);
+        for (int k = 0; k < used; ++k, ++i)
+            for (int j = 0; j < 4; ++j)
+                digest[i][j] = sum[j][k];
+    }
+}
+
+// Two lowercase hex characters of byte value, first character in low byte
+static uint32_t hexpair(const uint32_t byte)
+{
+    return (uint32_t)(uint8_t)hexc(byte >> 4) | (uint32_t)(uint8_t)hexc(byte & 0xf) << 8;
+}
+
+void mymd5_salt_stretch(Md5Salt * const ctx, uint32_t (* const digest)[4], const size_t count, const int stretch)
+{
+    uint32_t M[16][MYMD5_MAXLANES], sum[4][MYMD5_MAXLANES];
+    // Message of 32 hex chars: words 0-7 change every round, padding is fixed
+    for (int j = 8; j < 16; ++j)
+        for (int k = 0; k < MYMD5_MAXLANES; ++k)
+            M[j][k] = j == 8 ? 0x80 : (j == 14 ? 32 << 3 : 0);
+    size_t i = 0;
+    while (i < count) {
+        const int used = count - i < MYMD5_MAXLANES ? (int)(count - i) : MYMD5_MAXLANES;
+        mymd5_salt_batch(ctx, &digest[i], (size_t)used);
+        for (int k = 0; k < used; ++k)
+            for (int j = 0; j < 4; ++j)
+                sum[j][k] = digest[i + (size_t)k][j];
+        for (int n = 1; n < stretch; ++n) {
+            // Hex digest straight to message words, no string round trip
+            for (int j = 0; j < 4; ++j)
+                for (int k = 0; k < used; ++k) {
+                    const uint32_t x = sum[j][k];
+                    M[j << 1    ][k] = hexpair(x       & 0xff) | hexpair(x >>  8 & 0xff) << 16;
+                    M[j << 1 | 1][k] = hexpair(x >> 16 & 0xff) | hexpair(x >> 24       ) << 16;
+                }
+            for (int k = used; k < MYMD5_MAXLANES; ++k)  // unused lanes: keep vector loads defined
+                for (int j = 0; j < 8; ++j)
+                    M[j][k] = M[j][0];
+            kernel(M, sum, used, init, 0);
+        }
+        for (int k = 0; k < used; ++k, ++i)
+            for (int j = 0; j < 4; ++j)
+                digest[i][j] = sum[j][k];
+    }
+}
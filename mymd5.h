@@ -1,6 +1,12 @@
 #ifndef MYMD5_H
 #define MYMD5_H
 
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint32_t
+
+// Maximum number of messages hashed in parallel by mymd5_batch()
+#define MYMD5_MAXLANES 16
+
 // Ref.: https://en.wikipedia.org/wiki/MD5#Algorithm
 //   message must be null terminated string of any length
 //   digest buffer size must be >= 33 (32 hex characters + NUL)
@@ -8,9 +14,15 @@ void   mymd5        (const char * const message, char * const digest);
 
 // Return string pointer to md5 hex digest of message
 //   message must be null terminated string of any length
-// NB: not thread-safe because it uses a single static buffer
+// NB: not thread-safe because it uses a single static buffer, see mymd5_tostr_r
 char * mymd5_tostr  (const char * const message);
 
+// Return string pointer to md5 hex digest of message in caller-supplied buffer
+//   message must be null terminated string of any length
+//   digest buffer size must be >= 33 (32 hex characters + NUL)
+// Thread-safe, returns digest
+char * mymd5_tostr_r(const char * const message, char * const digest);
+
 // Print md5 hex digest of message to stdout
 //   message must be null terminated string of any length
 // NB: not thread-safe because mymd5_str() uses a single static buffer
@@ -27,4 +39,57 @@ void   mymd5_inplace(      char * const message);
 //   stretch should be > 0 and not very large
 void   mymd5_stretch(      char * const message, const int n);
 
+// Hex string from binary md5 digest (four 32-bit words a0,b0,c0,d0)
+//   digest buffer size must be >= 33 (32 hex characters + NUL)
+void   mymd5_hex    (const uint32_t * const sum, char * const digest);
+
+// All functions below are thread-safe: state is in caller-owned buffers and
+// the SIMD kernel is selected once at program startup.
+
+// Number of messages hashed in parallel by the SIMD kernel selected for this CPU
+//   1 = scalar fallback, 4 = SSE2/NEON, 8 = AVX2, 16 = AVX-512
+int    mymd5_lanes  (void);
+
+// Binary md5 digests of 'count' independent messages, hashed in parallel
+//   messages must be null terminated strings, preferably strlen <= 55
+//     (longer messages are hashed one at a time by the scalar algorithm)
+//   digest[i] will be four 32-bit words a0,b0,c0,d0 of messages[i], so the
+//     first two hex digits are in the lowest byte of digest[i][0]
+//   count may be any size, best performance when a multiple of MYMD5_MAXLANES
+void   mymd5_batch  (const char * const * const messages, uint32_t (* const digest)[4], const size_t count);
+
+// Salted counter message: fixed salt + incrementing decimal number
+//   salt strlen <= MYMD5_MAXSALT so that salt + 20 digits fit in one chunk
+#define MYMD5_MAXSALT 35
+typedef struct md5salt {
+    uint64_t index;     // current counter value
+    size_t saltlen;     // length of salt
+    size_t len;         // length of salt + decimal counter
+    int steps;          // number of md5 steps that depend only on the salt
+    uint32_t abcd[4];   // md5 state after those steps
+    uint32_t M[16];     // message words of current message
+    uint8_t chunk[64];  // padded message chunk
+} Md5Salt;
+
+// Initialise salted counter message as salt + start in decimal
+//   salt is truncated to MYMD5_MAXSALT characters
+void   mymd5_salt_init (Md5Salt * const ctx, const char * const salt, const uint64_t start);
+
+// Increment counter by one, updating only the affected message words
+void   mymd5_salt_next (Md5Salt * const ctx);
+
+// Binary md5 digest of current message (does not increment the counter)
+void   mymd5_salt_sum  (const Md5Salt * const ctx, uint32_t * const sum);
+
+// Binary md5 digests of 'count' consecutive counter values, hashed in parallel
+//   digest[i] is for counter value ctx->index + i (at the time of the call)
+//   counter is incremented by 'count'
+void   mymd5_salt_batch(Md5Salt * const ctx, uint32_t (* const digest)[4], const size_t count);
+
+// Binary md5 digests of 'count' consecutive counter values, key-stretched:
+// each digest is hashed again as a 32-char lowercase hex string, for a total
+// of 'stretch' hashes per counter value (stretch=1 is mymd5_salt_batch)
+//   counter is incremented by 'count'
+void   mymd5_salt_stretch(Md5Salt * const ctx, uint32_t (* const digest)[4], const size_t count, const int stretch);
+
 #endif
@@ -0,0 +1,343 @@
+/**
+ * PRIORITY QUEUES AND SHORTEST PATH SEARCH
+ * Freeware. No pull requests accepted.
+ * https://github.com/ednl
+ */
+
+#include <stdlib.h>  // malloc, free
+#include "pqueue.h"
+
+#define ALIGN 16  // arena alignment
+#define RADIX_BUCKETS 33  // key equal to last, or highest differing bit 0..31
+#define DARY 4  // children per node of indexed heap
+
+static size_t aligned(const size_t size)
+{
+    return (size + ALIGN - 1) & ~(size_t)(ALIGN - 1);
+}
+
+bool pq_arena_init(PQArena *const a, const size_t size)
+{
+    a->mem = malloc(size);
+    a->size = a->mem ? size : 0;
+    a->used = 0;
+    return a->mem != NULL;
+}
+
+void *pq_arena_alloc(PQArena *const a, const size_t size)
+{
+    const size_t need = aligned(size);
+    if (!a->mem || need > a->size - a->used)
+        return NULL;
+    void *p = a->mem + a->used;
+    a->used += need;
+    return p;
+}
+
+void pq_arena_reset(PQArena *const a)
+{
+    a->used = 0;
+}
+
+void pq_arena_free(PQArena *const a)
+{
+    free(a->mem);
+    *a = (PQArena){0};
+}
+
+// Dial: number of buckets = smallest power of 2 greater than spread
+static int dialbuckets(const PQKey spread)
+{
+    int n = 1;
+    while ((PQKey)n <= spread && n < (1 << 30))
+        n <<= 1;
+    return n;
+}
+
+size_t pq_need(const PQKind kind, const int cap, const PQKey spread)
+{
+    const size_t n = cap > 0 ? (size_t)cap : 0;
+    switch (kind) {
+        case PQ_RADIX:
+        case PQ_DIAL: {
+            const size_t buckets = kind == PQ_RADIX ? RADIX_BUCKETS : (size_t)dialbuckets(spread);
+            return aligned(n * sizeof(PQKey)) + 2 * aligned(n * sizeof(int)) + aligned(buckets * sizeof(int));
+        }
+        case PQ_DARY:
+            return aligned(n * sizeof(PQKey)) + 2 * aligned(n * sizeof(int));
+    }
+    return 0;
+}
+
+bool pq_init(PQueue *const q, const PQKind kind, const int cap, const PQKey spread, PQArena *const a)
+{
+    *q = (PQueue){.kind = kind, .cap = cap, .free = -1};
+    if (cap <= 0)
+        return false;
+    q->key = pq_arena_alloc(a, (size_t)cap * sizeof *q->key);
+    if (kind == PQ_DARY) {
+        q->heap = pq_arena_alloc(a, (size_t)cap * sizeof *q->heap);
+        q->pos = pq_arena_alloc(a, (size_t)cap * sizeof *q->pos);
+        if (!q->key || !q->heap || !q->pos)
+            return false;
+        for (int i = 0; i < cap; ++i)
+            q->pos[i] = -1;
+        return true;
+    }
+    q->buckets = kind == PQ_RADIX ? RADIX_BUCKETS : dialbuckets(spread);
+    q->val = pq_arena_alloc(a, (size_t)cap * sizeof *q->val);
+    q->next = pq_arena_alloc(a, (size_t)cap * sizeof *q->next);
+    q->head = pq_arena_alloc(a, (size_t)q->buckets * sizeof *q->head);
+    if (!q->key || !q->val || !q->next || !q->head)
+        return false;
+    for (int i = 0; i < q->buckets; ++i)
+        q->head[i] = -1;
+    for (int i = 0; i < cap - 1; ++i)
+        q->next[i] = i + 1;
+    q->next[cap - 1] = -1;
+    q->free = 0;
+    return true;
+}
+
+// Radix heap: bucket of key relative to last popped key
+static int radixbucket(const PQKey key, const PQKey last)
+{
+    return key == last ? 0 : 32 - __builtin_clz(key ^ last);
+}
+
+// Indexed heap: move heap[i] up to its place
+static void siftup(PQueue *const q, int i)
+{
+    const int id = q->heap[i];
+    const PQKey k = q->key[id];
+    while (i > 0) {
+        const int p = (i - 1) / DARY;
+        if (q->key[q->heap[p]] <= k)
+            break;
+        q->heap[i] = q->heap[p];
+        q->pos[q->heap[i]] = i;
+        i = p;
+    }
+    q->heap[i] = id;
+    q->pos[id] = i;
+}
+
+// Indexed heap: move heap[i] down to its place
+static void siftdown(PQueue *const q, int i)
+{
+    const int id = q->heap[i];
+    const PQKey k = q->key[id];
+    for (;;) {
+        const int c = i * DARY + 1;
+        if (c >= q->len)
+            break;
+        const int end = c + DARY < q->len ? c + DARY : q->len;
+        int best = c;
+        for (int j = c + 1; j < end; ++j)
+            if (q->key[q->heap[j]] < q->key[q->heap[best]])
+                best = j;
+        if (q->key[q->heap[best]] >= k)
+            break;
+        q->heap[i] = q->heap[best];
+        q->pos[q->heap[i]] = i;
+        i = best;
+    }
+    q->heap[i] = id;
+    q->pos[id] = i;
+}
+
+bool pq_push(PQueue *const q, const PQKey key, const int val)
+{
+    if (q->kind == PQ_DARY) {
+        if (val < 0 || val >= q->cap)
+            return false;
+        if (q->pos[val] >= 0) {
+            if (key < q->key[val]) {
+                q->key[val] = key;
+                siftup(q, q->pos[val]);
+            }
+            return true;
+        }
+        q->key[val] = key;
+        q->heap[q->len] = val;
+        siftup(q, q->len++);
+        return true;
+    }
+    if (!q->len)
+        q->last = key;  // empty: any key is fine
+    else if (key < q->last)
+        return false;
+    if (q->free < 0)
+        return false;
+    int b;
+    if (q->kind == PQ_RADIX)
+        b = radixbucket(key, q->last);
+    else if (key - q->last < (PQKey)q->buckets)
+        b = (int)(key & (PQKey)(q->buckets - 1));
+    else
+        return false;
+    const int i = q->free;
+    q->free = q->next[i];
+    q->key[i] = key;
+    q->val[i] = val;
+    q->next[i] = q->head[b];
+    q->head[b] = i;
+    q->len++;
+    return true;
+}
+
+bool pq_pop(PQueue *const q, PQKey *const key, int *const val)
+{
+    if (!q->len)
+        return false;
+    if (q->kind == PQ_DARY) {
+        const int id = q->heap[0];
+        *key = q->key[id];
+        *val = id;
+        q->pos[id] = -1;
+        if (--q->len) {
+            q->heap[0] = q->heap[q->len];
+            siftdown(q, 0);
+        }
+        return true;
+    }
+    int b;
+    if (q->kind == PQ_RADIX) {
+        if (q->head[0] < 0) {
+            // First non-empty bucket: its smallest key is the new 'last',
+            // relative to that all its items go to lower buckets
+            int r = 1;
+            while (q->head[r] < 0)
+                ++r;
+            PQKey min = PQ_INF;
+            for (int i = q->head[r]; i >= 0; i = q->next[i])
+                if (q->key[i] < min)
+                    min = q->key[i];
+            q->last = min;
+            for (int i = q->head[r], next; i >= 0; i = next) {
+                next = q->next[i];
+                const int c = radixbucket(q->key[i], min);
+                q->next[i] = q->head[c];
+                q->head[c] = i;
+            }
+            q->head[r] = -1;
+        }
+        b = 0;
+    } else {
+        const PQKey mask = (PQKey)(q->buckets - 1);
+        while (q->head[q->last & mask] < 0)
+            q->last++;
+        b = (int)(q->last & mask);
+    }
+    const int i = q->head[b];
+    q->head[b] = q->next[i];
+    *key = q->key[i];
+    *val = q->val[i];
+    q->next[i] = q->free;
+    q->free = i;
+    q->len--;
+    return true;
+}
+
+// Max items in queue: DARY once per state, others once per relaxed edge
+static int searchcap(const PQGraph *const g, const PQKind kind)
+{
+    const int64_t cap = kind == PQ_DARY ? g->states : (int64_t)g->states * (g->maxdeg + 1);
+    return cap > INT32_MAX ? INT32_MAX : (int)cap;
+}
+
+// Dial: keys grow by at most one edge cost with Dijkstra. With A* the key of
+// a neighbour is d + cost + h(v) and h(v) <= h(u) + cost when the heuristic
+// is consistent (|h(u) - h(v)| <= cost), so at most 2x edge cost above the
+// popped key d + h(u). An inconsistent heuristic makes pq_push() fail.
+static PQKey searchspread(const PQGraph *const g)
+{
+    return g->heuristic ? 2 * g->maxcost : g->maxcost;
+}
+
+size_t pq_search_need(const PQGraph *const g, const PQKind kind)
+{
+    return pq_need(kind, searchcap(g, kind), searchspread(g))
+        + aligned((size_t)g->maxdeg * sizeof(PQEdge));
+}
+
+PQKey pq_search(const PQGraph *const g, const int *const start, const int count,
+    PQKey *const dist, const PQKind kind, PQArena *const a)
+{
+    for (int i = 0; i < g->states; ++i)
+        dist[i] = PQ_INF;
+    pq_arena_reset(a);
+    PQueue q;
+    PQEdge *edge = pq_arena_alloc(a, (size_t)g->maxdeg * sizeof *edge);
+    if (!edge || !pq_init(&q, kind, searchcap(g, kind), searchspread(g), a))
+        return PQ_ERR;
+    for (int i = 0; i < count; ++i) {
+        dist[start[i]] = 0;
+        if (!pq_push(&q, g->heuristic ? g->heuristic(start[i], g->arg) : 0, start[i]))
+            return PQ_ERR;
+    }
+    PQKey key;
+    int cur;
+    while (pq_pop(&q, &key, &cur)) {
+        const PQKey d = dist[cur];
+        if (key != d + (g->heuristic ? g->heuristic(cur, g->arg) : 0))
+            continue;  // outdated duplicate
+        if (g->goal && g->goal(cur, g->arg))
+            return d;
+        const int n = g->edges(cur, edge, g->arg);
+        for (int i = 0; i < n; ++i) {
+            const int to = edge[i].to;
+            const PQKey alt = d + edge[i].cost;
+            if (alt < dist[to]) {
+                dist[to] = alt;
+                if (!pq_push(&q, g->heuristic ? alt + g->heuristic(to, g->arg) : alt, to))
+                    return PQ_ERR;
+            }
+        }
+    }
+    return PQ_INF;
+}
+
+static int gridedges(const int from, PQEdge *const out, void *arg)
+{
+    const PQGrid *const grid = arg;
+    const int r = from / grid->cols, c = from % grid->cols;
+    int n = 0;
+    if (c + 1 < grid->cols && grid->cost[from + 1])
+        out[n++] = (PQEdge){from + 1, grid->cost[from + 1]};
+    if (r + 1 < grid->rows && grid->cost[from + grid->cols])
+        out[n++] = (PQEdge){from + grid->cols, grid->cost[from + grid->cols]};
+    if (c > 0 && grid->cost[from - 1])
+        out[n++] = (PQEdge){from - 1, grid->cost[from - 1]};
+    if (r > 0 && grid->cost[from - grid->cols])
+        out[n++] = (PQEdge){from - grid->cols, grid->cost[from - grid->cols]};
+    return n;
+}
+
+static PQKey manhattan(const int state, void *arg)
+{
+    const PQGrid *const grid = arg;
+    const int dr = state / grid->cols - grid->goal / grid->cols;
+    const int dc = state % grid->cols - grid->goal % grid->cols;
+    return (PQKey)((dr >= 0 ? dr : -dr) + (dc >= 0 ? dc : -dc));
+}
+
+static bool isgoal(const int state, void *arg)
+{
+    return state == ((const PQGrid *)arg)->goal;
+}
+
+PQGraph pq_grid_graph(const PQGrid *const grid, const bool astar)
+{
+    const int states = grid->rows * grid->cols;
+    PQKey maxcost = 0;
+    for (int i = 0; i < states; ++i)
+        if (grid->cost[i] > maxcost)
+            maxcost = grid->cost[i];
+    return (PQGraph){
+        .states = states, .maxdeg = 4, .maxcost = maxcost,
+        .edges = gridedges,
+        .heuristic = astar ? manhattan : NULL,
+        .goal = grid->goal >= 0 ? isgoal : NULL,
+        .arg = (void *)grid};
+}
@@ -0,0 +1,137 @@
+/**
+ * PRIORITY QUEUES AND SHORTEST PATH SEARCH
+ * Monotone min-priority queues without allocation per item, and a generic
+ * Dijkstra/A* search over integer states, with a driver for 4-way grids.
+ * Freeware. No pull requests accepted.
+ * https://github.com/ednl
+ *
+ * Three kinds of queue, all with integer values and 32-bit keys:
+ *   PQ_RADIX  radix heap: monotone, any key range, amortised O(log C)
+ *   PQ_DIAL   Dial's buckets: monotone, keys at most 'spread' above the
+ *             last popped key, O(1) push and pop
+ *   PQ_DARY   indexed 4-ary heap with decrease-key: values are ids < cap,
+ *             every id is in the queue at most once
+ * Monotone means: never push a key smaller than the last popped key. That
+ * holds for Dijkstra, and for A* with a consistent heuristic.
+ * All storage comes from an arena that is allocated once and can be reused
+ * for every next search; radix and Dial queues link their items in a pool
+ * with a free list.
+ *
+ * Usage:
+ *     PQArena arena = {0};
+ *     PQGrid grid = {.rows = 100, .cols = 100, .cost = cost, .goal = 100 * 100 - 1};
+ *     PQGraph g = pq_grid_graph(&grid, true);  // A* with Manhattan distance
+ *     pq_arena_init(&arena, pq_search_need(&g, PQ_DIAL));
+ *     const PQKey risk = pq_search(&g, &start, 1, dist, PQ_DIAL, &arena);
+ *     pq_arena_free(&arena);
+ * Compile:
+ *     cc -std=c17 -Wall -Wextra -pedantic ../pqueue.c 15.c
+ */
+
+#ifndef PQUEUE_H
+#define PQUEUE_H
+
+#include <stddef.h>   // size_t
+#include <stdint.h>   // uint8_t, uint32_t
+#include <stdbool.h>  // bool
+
+#define PQ_INF UINT32_MAX      // unreachable
+#define PQ_ERR (UINT32_MAX - 1)  // search failed: out of room, or heuristic not consistent
+
+typedef uint32_t PQKey;
+
+typedef enum pqkind {
+    PQ_RADIX, PQ_DIAL, PQ_DARY
+} PQKind;
+
+// One allocation for all queue storage, reset before every search
+typedef struct pqarena {
+    unsigned char *mem;
+    size_t size, used;
+} PQArena;
+
+typedef struct pqueue {
+    PQKind kind;
+    int len, cap;   // items in queue, max items (DARY: max id + 1)
+    PQKey last;     // RADIX, DIAL: last popped key
+    PQKey *key;     // RADIX, DIAL: key per pool item; DARY: key per id
+    int *val;       // RADIX, DIAL: value per pool item
+    int *next;      // RADIX, DIAL: next item in bucket, or free list
+    int *head;      // RADIX, DIAL: first item per bucket, -1 = empty
+    int buckets;    // RADIX: 33, DIAL: power of 2 > spread
+    int free;       // RADIX, DIAL: first item of free list
+    int *heap;      // DARY: ids in heap order
+    int *pos;       // DARY: index in heap per id, -1 = not in queue
+} PQueue;
+
+// Edge from one state to another
+typedef struct pqedge {
+    int to;
+    PQKey cost;
+} PQEdge;
+
+// Graph of integer states 0..states-1 with non-negative edge costs
+typedef struct pqgraph {
+    int states;     // number of states
+    int maxdeg;     // max edges per state
+    PQKey maxcost;  // max cost of one edge
+    // Write edges from state 'from' to 'out' (room for maxdeg), return count
+    int (*edges)(const int from, PQEdge *const out, void *arg);
+    // A*: lower bound of cost to goal (NULL = Dijkstra). Must be consistent:
+    // |h(u) - h(v)| <= cost of every edge u-v, so that keys never decrease
+    // and never grow by more than 2 * maxcost (Dial's spread).
+    PQKey (*heuristic)(const int state, void *arg);
+    // Stop at first goal state popped from the queue (NULL = visit all)
+    bool (*goal)(const int state, void *arg);
+    void *arg;
+} PQGraph;
+
+// Grid of rows x cols cells, state = row * cols + col. Stepping into a
+// cell costs cost[state], 0 = wall. Goal and Manhattan heuristic use 'goal'.
+// Minimum cost per step must be 1 for the heuristic to be consistent.
+typedef struct pqgrid {
+    int rows, cols;
+    const uint8_t *cost;
+    int goal;
+} PQGrid;
+
+// Arena of 'size' bytes. Return: false if out of memory
+extern bool pq_arena_init(PQArena *const a, const size_t size);
+
+// Aligned memory from arena. Return: NULL if not enough room
+extern void *pq_arena_alloc(PQArena *const a, const size_t size);
+
+// Forget all allocations, keep memory
+extern void pq_arena_reset(PQArena *const a);
+
+extern void pq_arena_free(PQArena *const a);
+
+// Bytes of arena needed for one queue of this kind
+extern size_t pq_need(const PQKind kind, const int cap, const PQKey spread);
+
+// Empty queue with storage from arena, 'spread' only for PQ_DIAL
+// Return: false if not enough room in arena
+extern bool pq_init(PQueue *const q, const PQKind kind, const int cap, const PQKey spread, PQArena *const a);
+
+// Add value with key; DARY: lower the key if id 'val' is already queued
+// Return: false if full or key out of range (not monotone, or DIAL spread)
+extern bool pq_push(PQueue *const q, const PQKey key, const int val);
+
+// Remove value with smallest key. Return: false if queue was empty
+extern bool pq_pop(PQueue *const q, PQKey *const key, int *const val);
+
+// Bytes of arena needed for pq_search() on this graph
+extern size_t pq_search_need(const PQGraph *const g, const PQKind kind);
+
+// Shortest paths from all start states (cost 0). Resets the arena.
+// dist[]: cost from nearest start for every state, PQ_INF = not reached
+// (with a goal function: only exact for states that were popped)
+// Return: cost to first goal state found, PQ_INF if none,
+// PQ_ERR if out of room or a push failed (e.g. heuristic not consistent)
+extern PQKey pq_search(const PQGraph *const g, const int *const start, const int count,
+    PQKey *const dist, const PQKind kind, PQArena *const a);
+
+// Graph for a grid, optionally with Manhattan distance to grid->goal as heuristic
+extern PQGraph pq_grid_graph(const PQGrid *const grid, const bool astar);
+
+#endif
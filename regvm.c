@@ -0,0 +1,1026 @@
+/**
+ * REGISTER MACHINE TOOLKIT
+ * Freeware. No pull requests accepted.
+ * https://github.com/ednl
+ */
+
+#include <stdio.h>    // FILE, fopen, fgets, fprintf
+#include <stdlib.h>   // malloc, realloc, free, strtoll
+#include <string.h>   // strcmp, strtok, memcpy
+#include <stdint.h>   // int64_t
+#include <stdbool.h>
+#include "regvm.h"
+
+#define LINELEN 64  // max length of one source line
+
+static const char *const opname[RV_OPCOUNT] = {
+    "nop", "set", "add", "sub", "mul", "div", "mod", "and", "or", "shr", "gt", "eq",
+    "jmp", "jabs", "jnz", "jgz", "jev", "jeq", "snd", "rcv", "ext",
+    "ADDLOOP", "SUBLOOP", "MULLOOP", "DIVLOOP", "QUOTIENT", "DIVTEST", "DIVSUM", "brk"
+};
+
+////////// Operands and lowering helpers //////////////////////////////////////
+
+static RVArg argreg(const int reg)
+{
+    return (RVArg){reg, 0};
+}
+
+static RVArg argimm(const RVWord imm)
+{
+    return (RVArg){-1, imm};
+}
+
+static bool isreg(const RVArg a)
+{
+    return a.reg >= 0 && a.reg < RV_REGS;
+}
+
+// Value of operand
+static inline RVWord val(const RVWord *const reg, const RVArg a)
+{
+    return a.reg >= 0 ? reg[a.reg] : a.imm;
+}
+
+// Two-operand arithmetic, also used for constant folding
+// Return: false if division by zero
+static inline bool alu(const RVOp op, const RVWord x, const RVWord y, RVWord *const res)
+{
+    switch (op) {
+        case RV_SET: *res = x;      break;
+        case RV_ADD: *res = x + y;  break;
+        case RV_SUB: *res = x - y;  break;
+        case RV_MUL: *res = x * y;  break;
+        case RV_DIV: if (!y) return false; *res = x / y; break;
+        case RV_MOD: if (!y) return false; *res = x % y; break;
+        case RV_AND: *res = x & y;  break;
+        case RV_OR : *res = x | y;  break;
+        case RV_SHR: *res = x >> y; break;
+        case RV_GT : *res = x > y;  break;
+        case RV_EQ : *res = x == y; break;
+        default: return false;
+    }
+    return true;
+}
+
+// Conditional jump "jnz x y": constant condition becomes unconditional or NOP
+static void lowerjnz(const RVSrc *const src, RVInstr *const ins)
+{
+    if (src->arg[0].reg < 0) {
+        if (src->arg[0].imm)
+            *ins = (RVInstr){.op = RV_JMP, .x = src->arg[1], .y = argimm(0)};
+    } else
+        *ins = (RVInstr){.op = RV_JNZ, .x = src->arg[0], .y = src->arg[1]};
+}
+
+////////// Assembunny /////////////////////////////////////////////////////////
+
+enum { ABY_CPY, ABY_INC, ABY_DEC, ABY_JNZ, ABY_TGL, ABY_OUT, ABY_TAGS };
+static const char *const abyname[ABY_TAGS] = {"cpy", "inc", "dec", "jnz", "tgl", "out"};
+
+// Invalid instructions (e.g. after toggling) become NOP, as per 2016 day 23
+static bool abylower(const RVMachine *const m, const RVSrc *const src, const int at, RVInstr *const ins)
+{
+    (void)m; (void)at;
+    const RVArg *const a = src->arg;
+    *ins = (RVInstr){.op = RV_NOP};
+    switch (src->tag) {
+        case ABY_CPY:
+            if (src->argc == 2 && isreg(a[1]))
+                *ins = (RVInstr){.op = RV_SET, .dst = a[1].reg, .x = a[0]};
+            break;
+        case ABY_INC:
+        case ABY_DEC:
+            if (src->argc == 1 && isreg(a[0]))
+                *ins = (RVInstr){.op = RV_ADD, .dst = a[0].reg, .x = a[0], .y = argimm(src->tag == ABY_INC ? 1 : -1)};
+            break;
+        case ABY_JNZ:
+            if (src->argc == 2)
+                lowerjnz(src, ins);
+            break;
+        case ABY_TGL: *ins = (RVInstr){.op = RV_EXT, .x = a[0]}; break;
+        case ABY_OUT: *ins = (RVInstr){.op = RV_SND, .x = a[0]}; break;
+    }
+    return true;
+}
+
+// Toggle: one-argument instructions become inc or dec, two-argument ones jnz or cpy
+static bool abytoggle(RVMachine *const m, const RVInstr *const ins)
+{
+    const RVWord t = m->ip + val(m->reg, ins->x);
+    if (t < 0 || t >= m->size)
+        return true;  // nothing happens
+    RVSrc *const s = &m->src[t];
+    if (s->argc == 1)
+        s->tag = s->tag == ABY_INC ? ABY_DEC : ABY_INC;
+    else
+        s->tag = s->tag == ABY_JNZ ? ABY_CPY : ABY_JNZ;
+    return rv_recompile(m, (int)t);
+}
+
+const RVIsa rv_assembunny = {abyname, ABY_TAGS, abylower, abytoggle};
+
+////////// Elfcode ////////////////////////////////////////////////////////////
+
+enum { ELF_TAGS = 16 };
+static const char *const elfname[ELF_TAGS] = {
+    "addr", "addi", "mulr", "muli", "banr", "bani", "borr", "bori",
+    "setr", "seti", "gtrr", "gtir", "gtri", "eqrr", "eqir", "eqri"
+};
+
+// Generic operation and kind of parameters a and b: register, immediate, unused
+static const struct elfop { RVOp op; char a, b; } elfop[ELF_TAGS] = {
+    {RV_ADD, 'r', 'r'}, {RV_ADD, 'r', 'i'}, {RV_MUL, 'r', 'r'}, {RV_MUL, 'r', 'i'},
+    {RV_AND, 'r', 'r'}, {RV_AND, 'r', 'i'}, {RV_OR , 'r', 'r'}, {RV_OR , 'r', 'i'},
+    {RV_SET, 'r',  0 }, {RV_SET, 'i',  0 }, {RV_GT , 'r', 'r'}, {RV_GT , 'i', 'r'},
+    {RV_GT , 'r', 'i'}, {RV_EQ , 'r', 'r'}, {RV_EQ , 'i', 'r'}, {RV_EQ , 'r', 'i'}
+};
+
+// Elfcode operand: register index or value; reading the ip register gives 'at'
+static bool elfarg(const RVMachine *const m, const char kind, const RVArg src, const int at, RVArg *const arg)
+{
+    if (kind != 'r') {
+        *arg = argimm(kind ? src.imm : 0);
+        return true;
+    }
+    if (src.imm < 0 || src.imm >= RV_REGS)
+        return false;
+    *arg = src.imm == m->ipreg ? argimm(at) : argreg((int)src.imm);
+    return true;
+}
+
+// Writes to the ip register become jumps: constant, relative to a register, or absolute
+static bool elflower(const RVMachine *const m, const RVSrc *const src, const int at, RVInstr *const ins)
+{
+    if (src->argc != 3 || src->arg[2].imm < 0 || src->arg[2].imm >= RV_REGS)
+        return false;
+    const struct elfop *const e = &elfop[src->tag];
+    RVArg x, y;
+    if (!elfarg(m, e->a, src->arg[0], at, &x) || !elfarg(m, e->b, src->arg[1], at, &y))
+        return false;
+    const int dst = (int)src->arg[2].imm;
+    if (dst != m->ipreg) {
+        *ins = (RVInstr){.op = e->op, .dst = dst, .x = x, .y = y};
+        return true;
+    }
+    RVWord to;
+    if (x.reg < 0 && y.reg < 0 && alu(e->op, x.imm, y.imm, &to))
+        *ins = (RVInstr){.op = RV_JMP, .x = argimm(to + 1 - at), .y = argimm(0)};
+    else if (e->op == RV_ADD && (x.reg < 0) != (y.reg < 0))
+        *ins = (RVInstr){.op = RV_JMP, .x = x.reg < 0 ? y : x, .y = argimm((x.reg < 0 ? x.imm : y.imm) + 1 - at)};
+    else if (e->op == RV_SET)
+        *ins = (RVInstr){.op = RV_JABS, .x = x, .y = argimm(1)};
+    else
+        return false;  // computed jump not supported
+    return true;
+}
+
+const RVIsa rv_elfcode = {elfname, ELF_TAGS, elflower, NULL};
+
+////////// Duet ///////////////////////////////////////////////////////////////
+
+enum { DUET_SET, DUET_ADD, DUET_SUB, DUET_MUL, DUET_MOD, DUET_JGZ, DUET_JNZ, DUET_SND, DUET_RCV, DUET_TAGS };
+static const char *const duetname[DUET_TAGS] = {"set", "add", "sub", "mul", "mod", "jgz", "jnz", "snd", "rcv"};
+
+static bool duetlower(const RVMachine *const m, const RVSrc *const src, const int at, RVInstr *const ins)
+{
+    (void)m; (void)at;
+    static const RVOp arith[DUET_TAGS] = {
+        [DUET_ADD] = RV_ADD, [DUET_SUB] = RV_SUB, [DUET_MUL] = RV_MUL, [DUET_MOD] = RV_MOD
+    };
+    const RVArg *const a = src->arg;
+    const int argc = src->tag >= DUET_SND ? 1 : 2;
+    if (src->argc != argc || (src->tag != DUET_JGZ && src->tag != DUET_JNZ && src->tag != DUET_SND && !isreg(a[0])))
+        return false;
+    *ins = (RVInstr){.op = RV_NOP};
+    switch (src->tag) {
+        case DUET_SET: *ins = (RVInstr){.op = RV_SET, .dst = a[0].reg, .x = a[1]}; break;
+        case DUET_ADD:
+        case DUET_SUB:
+        case DUET_MUL:
+        case DUET_MOD: *ins = (RVInstr){.op = arith[src->tag], .dst = a[0].reg, .x = a[0], .y = a[1]}; break;
+        case DUET_JGZ:
+            if (a[0].reg >= 0)
+                *ins = (RVInstr){.op = RV_JGZ, .x = a[0], .y = a[1]};
+            else if (a[0].imm > 0)
+                *ins = (RVInstr){.op = RV_JMP, .x = a[1], .y = argimm(0)};
+            break;
+        case DUET_JNZ: lowerjnz(src, ins); break;
+        case DUET_SND: *ins = (RVInstr){.op = RV_SND, .x = a[0]}; break;
+        case DUET_RCV: *ins = (RVInstr){.op = RV_RCV, .dst = a[0].reg}; break;
+    }
+    return true;
+}
+
+const RVIsa rv_duet = {duetname, DUET_TAGS, duetlower, NULL};
+
+////////// Turing lock ////////////////////////////////////////////////////////
+
+enum { TUR_HLF, TUR_TPL, TUR_INC, TUR_JMP, TUR_JIE, TUR_JIO, TUR_TAGS };
+static const char *const turname[TUR_TAGS] = {"hlf", "tpl", "inc", "jmp", "jie", "jio"};
+
+static bool turlower(const RVMachine *const m, const RVSrc *const src, const int at, RVInstr *const ins)
+{
+    (void)m; (void)at;
+    const RVArg *const a = src->arg;
+    const int argc = src->tag == TUR_JMP ? 1 : (src->tag >= TUR_JIE ? 2 : 1);
+    if (src->argc != argc || (src->tag != TUR_JMP && !isreg(a[0])))
+        return false;
+    switch (src->tag) {
+        case TUR_HLF: *ins = (RVInstr){.op = RV_DIV, .dst = a[0].reg, .x = a[0], .y = argimm(2)}; break;
+        case TUR_TPL: *ins = (RVInstr){.op = RV_MUL, .dst = a[0].reg, .x = a[0], .y = argimm(3)}; break;
+        case TUR_INC: *ins = (RVInstr){.op = RV_ADD, .dst = a[0].reg, .x = a[0], .y = argimm(1)}; break;
+        case TUR_JMP: *ins = (RVInstr){.op = RV_JMP, .x = a[0], .y = argimm(0)}; break;
+        case TUR_JIE: *ins = (RVInstr){.op = RV_JEV, .x = a[0], .y = a[1]}; break;
+        case TUR_JIO: *ins = (RVInstr){.op = RV_JEQ, .x = a[0], .y = a[1], .k = 1}; break;
+    }
+    return true;
+}
+
+const RVIsa rv_turing = {turname, TUR_TAGS, turlower, NULL};
+
+////////// Peephole optimiser /////////////////////////////////////////////////
+
+// Instruction adds a constant to a register: r += k
+static bool isinc(const RVInstr *const i, int *const r, RVWord *const k)
+{
+    if ((i->op != RV_ADD && i->op != RV_SUB) || i->x.reg != i->dst || i->y.reg >= 0)
+        return false;
+    *r = i->dst;
+    *k = i->op == RV_ADD ? i->y.imm : -i->y.imm;
+    return true;
+}
+
+// Instruction is "jnz r off" with constant offset
+static bool isjnz(const RVInstr *const i, const int r, const RVWord off)
+{
+    return i->op == RV_JNZ && i->x.reg == r && i->y.reg < 0 && i->y.imm == off;
+}
+
+// Instruction is unconditional jump with constant offset
+static bool isjmp(const RVInstr *const i, const RVWord off)
+{
+    return i->op == RV_JMP && i->x.reg < 0 && i->y.reg < 0 && i->x.imm + i->y.imm == off;
+}
+
+// Two increments where one is a counter that goes down by one: acc += k per step
+static bool twoinc(const RVInstr *const i, const int counter, int *const acc, RVWord *const k)
+{
+    int r0, r1;
+    RVWord k0, k1;
+    if (!isinc(&i[0], &r0, &k0) || !isinc(&i[1], &r1, &k1) || r0 == r1)
+        return false;
+    if (r1 == counter && k1 == -1) {
+        *acc = r0;
+        *k = k0;
+        return true;
+    }
+    if (r0 == counter && k0 == -1) {
+        *acc = r1;
+        *k = k1;
+        return true;
+    }
+    return false;
+}
+
+// Add loop, 3 lines: "inc a; dec c; jnz c -2" (either order)
+static bool addloop(const RVInstr *const i, const int n, RVInstr *const fused)
+{
+    if (n < 3 || i[2].op != RV_JNZ || i[2].x.reg < 0 || !isjnz(&i[2], i[2].x.reg, -2))
+        return false;
+    const int c = i[2].x.reg;
+    int a;
+    RVWord k;
+    if (!twoinc(i, c, &a, &k))
+        return false;
+    *fused = (RVInstr){.op = RV_ADDLOOP, .dst = a, .x = argreg(c), .k = k, .len = 3};
+    return true;
+}
+
+// Multiply loop, 6 lines: "cpy b c; <add loop a,c>; dec d; jnz d -5"
+static bool mulloop(const RVInstr *const i, const int n, RVInstr *const fused)
+{
+    RVInstr add;
+    int d;
+    RVWord kd;
+    if (n < 6 || i[0].op != RV_SET || !addloop(&i[1], n - 1, &add)
+        || add.x.reg != i[0].dst || !isinc(&i[4], &d, &kd) || kd != -1 || !isjnz(&i[5], d, -5))
+        return false;
+    const int a = add.dst, c = i[0].dst;
+    const RVArg b = i[0].x;
+    if (d == a || d == c || b.reg == c || b.reg == d || b.reg == a)
+        return false;
+    *fused = (RVInstr){.op = RV_MULLOOP, .dst = a, .x = b, .y = argreg(d), .aux = c, .k = add.k, .len = 6};
+    return true;
+}
+
+// Divide loop, 8 lines: "cpy K c; jnz b 2; jnz 1 6; dec b; dec c; jnz c -4; inc a; jnz 1 -7"
+static bool divloop(const RVInstr *const i, const int n, RVInstr *const fused)
+{
+    if (n < 8 || i[0].op != RV_SET || i[0].x.reg >= 0 || i[0].x.imm <= 0)
+        return false;
+    const int c = i[0].dst;
+    const RVWord divisor = i[0].x.imm;
+    if (i[1].op != RV_JNZ || i[1].x.reg < 0 || !isjnz(&i[1], i[1].x.reg, 2) || !isjmp(&i[2], 6))
+        return false;
+    const int b = i[1].x.reg;
+    int r0, r1, a;
+    RVWord k0, k1, ka;
+    if (!isinc(&i[3], &r0, &k0) || !isinc(&i[4], &r1, &k1) || k0 != -1 || k1 != -1
+        || !((r0 == b && r1 == c) || (r0 == c && r1 == b)) || !isjnz(&i[5], c, -4)
+        || !isinc(&i[6], &a, &ka) || ka != 1 || !isjmp(&i[7], -7) || a == b || a == c || b == c)
+        return false;
+    *fused = (RVInstr){.op = RV_DIVLOOP, .dst = a, .x = argreg(b), .aux = c, .k = divisor, .len = 8};
+    return true;
+}
+
+// Subtract loop, 5 lines: "jnz c 2; jnz 1 4; dec b; dec c; jnz 1 -4" (while loop)
+static bool subloop(const RVInstr *const i, const int n, RVInstr *const fused)
+{
+    if (n < 5 || i[0].op != RV_JNZ || i[0].x.reg < 0 || !isjnz(&i[0], i[0].x.reg, 2)
+        || !isjmp(&i[1], 4) || !isjmp(&i[4], -4))
+        return false;
+    const int c = i[0].x.reg;
+    int b;
+    RVWord k;
+    if (!twoinc(&i[2], c, &b, &k))
+        return false;
+    *fused = (RVInstr){.op = RV_SUBLOOP, .dst = b, .x = argreg(c), .k = k, .len = 5};
+    return true;
+}
+
+// Instruction is "dst = r1 OP r2" on registers, either order if commutative
+static bool isregop(const RVInstr *const i, const RVOp op, const int dst, const int r1, const int r2)
+{
+    if (i->op != op || i->dst != dst || i->x.reg < 0 || i->y.reg < 0)
+        return false;
+    return (i->x.reg == r1 && i->y.reg == r2) || (op != RV_GT && i->x.reg == r2 && i->y.reg == r1);
+}
+
+// Instruction is "dst = r + k" with constant k, either order
+static bool isaddimm(const RVInstr *const i, const int dst, const int r, const RVWord k)
+{
+    return i->op == RV_ADD && i->dst == dst
+        && ((i->x.reg == r && i->y.reg < 0 && i->y.imm == k) || (i->y.reg == r && i->x.reg < 0 && i->x.imm == k));
+}
+
+// Instruction is "r = k" with constant k
+static bool isset(const RVInstr *const i, const int r, const RVWord k)
+{
+    return i->op == RV_SET && i->dst == r && i->x.reg < 0 && i->x.imm == k;
+}
+
+// Elfcode "addr r ip ip": skip next line if flag register is 1
+static bool isskip(const RVInstr *const i, const int r)
+{
+    return i->op == RV_JMP && i->x.reg == r && i->y.reg < 0 && i->y.imm == 1;
+}
+
+// All register indices different
+static bool distinct(const int *const r, const int n)
+{
+    for (int i = 0; i < n; ++i)
+        for (int j = i + 1; j < n; ++j)
+            if (r[i] == r[j])
+                return false;
+    return true;
+}
+
+// Quotient by search, 9 lines (Elfcode): "e = 0; c = e + 1; c *= K; c = c > b;
+// skip if c; jmp +2; jmp +3; e += 1; jmp -7", result e = b / K
+static bool quotient(const RVInstr *const i, const int n, RVInstr *const fused)
+{
+    if (n < 9 || !isset(&i[0], i[0].dst, 0) || i[2].op != RV_MUL)
+        return false;
+    const int e = i[0].dst, c = i[1].dst;
+    RVWord k;
+    if (i[2].x.reg == c && i[2].y.reg < 0)
+        k = i[2].y.imm;
+    else if (i[2].y.reg == c && i[2].x.reg < 0)
+        k = i[2].x.imm;
+    else
+        return false;
+    const int b = i[3].y.reg;
+    if (k <= 0 || i[2].dst != c || !isaddimm(&i[1], c, e, 1) || !isregop(&i[3], RV_GT, c, c, b)
+        || !isskip(&i[4], c) || !isjmp(&i[5], 2) || !isjmp(&i[6], 3) || !isaddimm(&i[7], e, e, 1)
+        || !isjmp(&i[8], -7) || !distinct((int[]){b, c, e}, 3))
+        return false;
+    *fused = (RVInstr){.op = RV_QUOTIENT, .dst = e, .x = argreg(b), .aux = c, .k = k, .len = 9};
+    return true;
+}
+
+// Divisor test, 9 lines (Elfcode): "d = f * b; d = d == c; skip if d; jmp +2;
+// a += f; b += 1; d = b > c; skip if d; jmp -8", adds f to a if f divides c
+static bool divtest(const RVInstr *const i, const int n, RVInstr *const fused)
+{
+    int b;
+    RVWord k;
+    if (n < 9 || !isinc(&i[5], &b, &k) || k != 1)
+        return false;
+    const int d = i[0].dst, a = i[4].dst;
+    const int f = i[0].x.reg == b ? i[0].y.reg : i[0].x.reg;
+    const int c = i[1].x.reg == d ? i[1].y.reg : i[1].x.reg;
+    if (!isregop(&i[0], RV_MUL, d, f, b) || !isregop(&i[1], RV_EQ, d, d, c) || !isskip(&i[2], d)
+        || !isjmp(&i[3], 2) || !isregop(&i[4], RV_ADD, a, f, a) || !isregop(&i[6], RV_GT, d, b, c)
+        || !isskip(&i[7], d) || !isjmp(&i[8], -8) || !distinct((int[]){a, b, c, d, f}, 5))
+        return false;
+    *fused = (RVInstr){.op = RV_DIVTEST, .dst = a, .x = argreg(f), .y = argreg(b), .aux = d, .lim = c, .len = 9};
+    return true;
+}
+
+#define MAXFUSE 15  // longest pattern: divisor sum
+
+// Divisor sum, 15 lines (Elfcode): "f = 1; b = 1; <divisor test>; f += 1;
+// d = f > c; skip if d; jmp -13", adds all divisors of c to a
+static bool divsum(const RVInstr *const i, const int n, RVInstr *const fused)
+{
+    RVInstr test;
+    int f;
+    RVWord k;
+    if (n < 15 || !divtest(&i[2], n - 2, &test) || !isinc(&i[11], &f, &k) || k != 1 || f != test.x.reg)
+        return false;
+    const int b = test.y.reg, c = test.lim, d = test.aux;
+    if (!isset(&i[0], f, 1) || !isset(&i[1], b, 1) || !isregop(&i[12], RV_GT, d, f, c)
+        || !isskip(&i[13], d) || !isjmp(&i[14], -13))
+        return false;
+    *fused = test;
+    fused->op = RV_DIVSUM;
+    fused->len = 15;
+    return true;
+}
+
+// Replace first line of every recognised loop in lines beg..end-1 by a fused instruction
+// Patterns are matched on the unoptimised program, so loops can be nested
+static void optimise(RVMachine *const m, const int beg, const int end)
+{
+    for (int i = beg; i < end; ++i) {
+        const RVInstr *const at = &m->orig[i];
+        const int n = m->size - i;
+        RVInstr fused;
+        if (divsum(at, n, &fused) || divtest(at, n, &fused) || quotient(at, n, &fused)
+            || divloop(at, n, &fused) || mulloop(at, n, &fused) || subloop(at, n, &fused) || addloop(at, n, &fused))
+            m->mem[i] = fused;
+    }
+}
+
+////////// Program management /////////////////////////////////////////////////
+
+bool rv_compile(RVMachine *const m)
+{
+    if (m->size <= 0)
+        return false;
+    RVInstr *t = realloc(m->orig, m->size * sizeof *t);
+    if (!t)
+        return false;
+    m->orig = t;
+    if (!(t = realloc(m->mem, m->size * sizeof *t)))
+        return false;
+    m->mem = t;
+    for (int i = 0; i < m->size; ++i)
+        if (m->src[i].tag < 0 || m->src[i].tag >= m->isa->tags || !m->isa->lower(m, &m->src[i], i, &m->orig[i]))
+            return false;
+    memcpy(m->mem, m->orig, m->size * sizeof *m->mem);
+    if (m->optimise)
+        optimise(m, 0, m->size);
+    if (m->onbreak && m->brk >= 0 && m->brk < m->size) {
+        m->brkins = m->mem[m->brk];
+        m->mem[m->brk] = (RVInstr){.op = RV_BRK};
+    }
+    return true;
+}
+
+// Only fused loops that start at most MAXFUSE-1 lines before 'at' can include it
+bool rv_recompile(RVMachine *const m, const int at)
+{
+    if (at < 0 || at >= m->size || !m->orig)
+        return false;
+    if (m->src[at].tag < 0 || m->src[at].tag >= m->isa->tags || !m->isa->lower(m, &m->src[at], at, &m->orig[at]))
+        return false;
+    const int beg = at >= MAXFUSE ? at - MAXFUSE + 1 : 0, end = at + 1;
+    memcpy(&m->mem[beg], &m->orig[beg], (end - beg) * sizeof *m->mem);
+    if (m->optimise)
+        optimise(m, beg, end);
+    if (m->onbreak && m->brk >= beg && m->brk < end) {
+        m->brkins = m->mem[m->brk];
+        m->mem[m->brk] = (RVInstr){.op = RV_BRK};
+    }
+    return true;
+}
+
+bool rv_setsrc(RVMachine *const m, const RVIsa *const isa, const RVSrc *const src, const int size, const bool optimise)
+{
+    if (size <= 0 || (src == m->src && size > m->size))
+        return false;
+    if (src != m->src) {  // else: same program, other ISA or optimisation
+        RVSrc *t = malloc(size * sizeof *t);
+        if (!t)
+            return false;
+        memcpy(t, src, size * sizeof *t);
+        free(m->src);
+        m->src = t;
+    }
+    m->size = size;
+    m->isa = isa;
+    m->optimise = optimise;
+    return rv_compile(m);
+}
+
+// Find tag of mnemonic
+static int tagof(const RVIsa *const isa, const char *const s)
+{
+    for (int i = 0; i < isa->tags; ++i)
+        if (!strcmp(isa->name[i], s))
+            return i;
+    return -1;
+}
+
+bool rv_load(RVMachine *const m, const RVIsa *const isa, const char *const fname, const bool optimise)
+{
+    FILE *f = fopen(fname, "r");
+    if (!f)
+        return false;
+    RVSrc *src = NULL;
+    int n = 0, cap = 0, ipreg = -1;
+    char buf[LINELEN];
+    bool ok = true;
+    while (ok && fgets(buf, sizeof buf, f)) {
+        if (buf[0] == '#') {  // Elfcode: "#ip 3"
+            ipreg = atoi(buf + 4);
+            continue;
+        }
+        char *tok = strtok(buf, " ,\r\n");
+        if (!tok)
+            continue;  // empty line
+        if (n == cap) {
+            cap = cap ? cap * 2 : 32;
+            RVSrc *t = realloc(src, cap * sizeof *t);
+            if (!t) {
+                ok = false;
+                break;
+            }
+            src = t;
+        }
+        RVSrc *const s = &src[n++];
+        *s = (RVSrc){.tag = tagof(isa, tok)};
+        ok = s->tag >= 0;
+        while (ok && (tok = strtok(NULL, " ,\r\n")) && s->argc < 3)
+            s->arg[s->argc++] = tok[0] >= 'a' && tok[0] <= 'z' && !tok[1]
+                ? argreg(tok[0] - 'a')
+                : argimm(strtoll(tok, NULL, 10));
+    }
+    fclose(f);
+    m->ipreg = ipreg;
+    ok = ok && rv_setsrc(m, isa, src, n, optimise);
+    free(src);
+    return ok;
+}
+
+void rv_reset(RVMachine *const m)
+{
+    memset(m->reg, 0, sizeof m->reg);
+    m->ip = 0;
+    m->ticks = 0;
+    m->state = RV_STATE_OK;
+}
+
+void rv_break(RVMachine *const m, const int at, bool (*onbreak)(RVMachine *const m, void *arg))
+{
+    if (m->onbreak && m->brk >= 0 && m->brk < m->size)
+        m->mem[m->brk] = m->brkins;  // remove old breakpoint
+    m->onbreak = onbreak;
+    m->brk = at;
+    if (onbreak && at >= 0 && at < m->size) {
+        m->brkins = m->mem[at];
+        m->mem[at] = (RVInstr){.op = RV_BRK};
+    }
+}
+
+void rv_free(RVMachine *const m)
+{
+    free(m->src);
+    free(m->orig);
+    free(m->mem);
+    *m = (RVMachine){0};
+}
+
+////////// Queues /////////////////////////////////////////////////////////////
+
+bool rv_push(RVQueue *const q, const RVWord val)
+{
+    if (q->len == q->cap) {
+        const int cap = q->cap ? q->cap * 2 : 64;
+        RVWord *t = malloc(cap * sizeof *t);
+        if (!t)
+            return false;
+        for (int i = 0; i < q->len; ++i)  // unwrap ring buffer
+            t[i] = q->q[(q->pop + i) % q->cap];
+        free(q->q);
+        q->q = t;
+        q->cap = cap;
+        q->pop = 0;
+        q->ins = q->len;
+    }
+    q->q[q->ins] = val;
+    if (++q->ins == q->cap)
+        q->ins = 0;
+    q->len++;
+    q->total++;
+    return true;
+}
+
+bool rv_pop(RVQueue *const q, RVWord *const val)
+{
+    if (!q->len)
+        return false;
+    *val = q->q[q->pop];
+    if (++q->pop == q->cap)
+        q->pop = 0;
+    q->len--;
+    return true;
+}
+
+void rv_qfree(RVQueue *const q)
+{
+    free(q->q);
+    *q = (RVQueue){0};
+}
+
+////////// Interpreter ////////////////////////////////////////////////////////
+
+// Sum of all divisors of n > 0 from its prime factorisation
+static RVWord divisorsum(RVWord n)
+{
+    RVWord sum = 1;
+    for (RVWord p = 2; p * p <= n; ++p)
+        if (!(n % p)) {
+            RVWord pk = 1, term = 1;  // 1 + p + p^2 + .. + p^a
+            do {
+                pk *= p;
+                term += pk;
+                n /= p;
+            } while (!(n % p));
+            sum *= term;
+        }
+    return n > 1 ? sum * (n + 1) : sum;  // remaining prime factor
+}
+
+// Fused loops check their precondition, else the original first line runs
+static RVState exec(RVMachine *const m, const bool traced)
+{
+    RVWord *const reg = m->reg;
+    int ip = m->ip;
+    // Resume after a stop: trace has already seen this instruction, and
+    // onbreak too if that was what stopped the machine
+    int skiptrace = m->state == RV_STATE_BRK ? ip : -1;
+    int skipbrk = m->state == RV_STATE_BRK && m->brkstop ? ip : -1;
+    int64_t ticks = m->ticks;
+    RVState state = RV_STATE_HLT;
+    while (ip >= 0 && ip < m->size) {
+        const RVInstr *ins = &m->mem[ip];
+        if (traced) {
+            m->ip = ip;
+            m->ticks = ticks;
+            if (ip != skiptrace && !m->trace(m, ins->op == RV_BRK ? &m->brkins : ins, m->arg)) {
+                state = RV_STATE_BRK;
+                m->brkstop = false;
+                goto stop;
+            }
+            skiptrace = -1;
+        }
+        ticks++;
+    again:
+        switch (ins->op) {
+            case RV_NOP:
+                break;
+            case RV_SET:
+                reg[ins->dst] = val(reg, ins->x);
+                break;
+            case RV_ADD: reg[ins->dst] = val(reg, ins->x) + val(reg, ins->y); break;
+            case RV_SUB: reg[ins->dst] = val(reg, ins->x) - val(reg, ins->y); break;
+            case RV_MUL: reg[ins->dst] = val(reg, ins->x) * val(reg, ins->y); break;
+            case RV_DIV:
+            case RV_MOD:
+            case RV_AND:
+            case RV_OR :
+            case RV_SHR:
+            case RV_GT :
+            case RV_EQ :
+                if (!alu(ins->op, val(reg, ins->x), val(reg, ins->y), &reg[ins->dst])) {
+                    state = RV_STATE_ERR;  // division by zero
+                    goto stop;
+                }
+                break;
+            case RV_JMP:
+                ip += (int)(val(reg, ins->x) + val(reg, ins->y));
+                continue;
+            case RV_JABS:
+                ip = (int)(val(reg, ins->x) + val(reg, ins->y));
+                continue;
+            case RV_JNZ:
+                if (val(reg, ins->x) != 0) {
+                    ip += (int)val(reg, ins->y);
+                    continue;
+                }
+                break;
+            case RV_JGZ:
+                if (val(reg, ins->x) > 0) {
+                    ip += (int)val(reg, ins->y);
+                    continue;
+                }
+                break;
+            case RV_JEV:
+                if (!(val(reg, ins->x) & 1)) {
+                    ip += (int)val(reg, ins->y);
+                    continue;
+                }
+                break;
+            case RV_JEQ:
+                if (val(reg, ins->x) == ins->k) {
+                    ip += (int)val(reg, ins->y);
+                    continue;
+                }
+                break;
+            case RV_SND:
+                if (m->out && !rv_push(m->out, val(reg, ins->x))) {  // no queue: discard
+                    state = RV_STATE_ERR;
+                    goto stop;
+                }
+                break;
+            case RV_RCV:
+                if (!m->inp || !rv_pop(m->inp, &reg[ins->dst])) {
+                    ticks--;  // not executed yet
+                    state = RV_STATE_RCV;
+                    goto stop;
+                }
+                break;
+            case RV_EXT:
+                m->ip = ip;
+                if (!m->isa->ext || !m->isa->ext(m, ins)) {
+                    state = RV_STATE_ERR;
+                    goto stop;
+                }
+                break;
+            case RV_ADDLOOP: {
+                const RVWord n = reg[ins->x.reg];
+                if (n > 0) {
+                    reg[ins->dst] += ins->k * n;
+                    reg[ins->x.reg] = 0;
+                    ip += ins->len;
+                    continue;
+                }
+                ins = &m->orig[ip];
+                goto again;
+            }
+            case RV_SUBLOOP: {
+                const RVWord n = reg[ins->x.reg];
+                if (n >= 0) {
+                    reg[ins->dst] += ins->k * n;
+                    reg[ins->x.reg] = 0;
+                    ip += ins->len;
+                    continue;
+                }
+                ins = &m->orig[ip];
+                goto again;
+            }
+            case RV_MULLOOP: {
+                const RVWord n = val(reg, ins->x), outer = reg[ins->y.reg];
+                if (n > 0 && outer > 0) {
+                    reg[ins->dst] += ins->k * n * outer;
+                    reg[ins->aux] = 0;
+                    reg[ins->y.reg] = 0;
+                    ip += ins->len;
+                    continue;
+                }
+                ins = &m->orig[ip];
+                goto again;
+            }
+            case RV_DIVLOOP: {
+                const RVWord n = reg[ins->x.reg];
+                if (n >= 0) {
+                    reg[ins->dst] += n / ins->k;
+                    reg[ins->aux] = ins->k - n % ins->k;
+                    reg[ins->x.reg] = 0;
+                    ip += ins->len;
+                    continue;
+                }
+                ins = &m->orig[ip];
+                goto again;
+            }
+            case RV_QUOTIENT: {
+                const RVWord n = reg[ins->x.reg];
+                if (n >= 0) {
+                    reg[ins->dst] = n / ins->k;
+                    reg[ins->aux] = 1;
+                    ip += ins->len;
+                    continue;
+                }
+                ins = &m->orig[ip];
+                goto again;
+            }
+            case RV_DIVTEST: {
+                const RVWord f = reg[ins->x.reg], b = reg[ins->y.reg], n = reg[ins->lim];
+                if (f > 0 && b <= n) {
+                    if (!(n % f) && n / f >= b && n / f <= n)
+                        reg[ins->dst] += f;
+                    reg[ins->y.reg] = n + 1;
+                    reg[ins->aux] = 1;
+                    ip += ins->len;
+                    continue;
+                }
+                ins = &m->orig[ip];
+                goto again;
+            }
+            case RV_DIVSUM: {
+                const RVWord n = reg[ins->lim];
+                if (n > 0) {
+                    reg[ins->dst] += divisorsum(n);
+                    reg[ins->x.reg] = reg[ins->y.reg] = n + 1;
+                    reg[ins->aux] = 1;
+                    ip += ins->len;
+                    continue;
+                }
+                ins = &m->orig[ip];
+                goto again;
+            }
+            case RV_BRK:
+                if (ip != skipbrk) {
+                    m->ip = ip;
+                    m->ticks = ticks - 1;
+                    if (!m->onbreak(m, m->brkarg)) {
+                        ticks--;  // not executed yet
+                        state = RV_STATE_BRK;
+                        m->brkstop = true;
+                        goto stop;
+                    }
+                }
+                skipbrk = -1;
+                ins = &m->brkins;
+                goto again;
+            case RV_OPCOUNT:
+                state = RV_STATE_ERR;
+                goto stop;
+        }
+        ip++;
+    }
+stop:
+    m->ip = ip;
+    m->ticks = ticks;
+    return (m->state = state);
+}
+
+RVState rv_run(RVMachine *const m)
+{
+    if (!m->mem || m->state == RV_STATE_HLT || m->state == RV_STATE_ERR)
+        return m->state;
+    return m->trace ? exec(m, true) : exec(m, false);
+}
+
+////////// Cycle detection ////////////////////////////////////////////////////
+
+#define SETINIT 1024  // initial hash set capacity, power of 2
+
+// Register watch with open addressing hash set of values seen
+typedef struct watch {
+    RVWord *val;
+    bool *used;
+    size_t cap, len;  // cap is power of 2
+    int reg;
+    bool ok;          // false after allocation error
+    RVCycle *res;
+} Watch;
+
+static size_t hashval(const RVWord v)
+{
+    const uint64_t x = (uint64_t)v * UINT64_C(0x9E3779B97F4A7C15);  // Fibonacci hashing
+    return (size_t)(x ^ x >> 29);
+}
+
+// Add value to set, grow at 50% load
+// Return: false if value was already present (or on allocation error)
+static bool setadd(Watch *const w, const RVWord v)
+{
+    if (w->len * 2 >= w->cap) {
+        const size_t cap = w->cap ? w->cap * 2 : SETINIT;
+        RVWord *val = malloc(cap * sizeof *val);
+        bool *used = calloc(cap, sizeof *used);
+        if (!val || !used) {
+            free(val);
+            free(used);
+            return (w->ok = false);
+        }
+        for (size_t i = 0; i < w->cap; ++i)
+            if (w->used[i]) {
+                size_t j = hashval(w->val[i]) & (cap - 1);
+                while (used[j])
+                    j = (j + 1) & (cap - 1);
+                val[j] = w->val[i];
+                used[j] = true;
+            }
+        free(w->val);
+        free(w->used);
+        w->val = val;
+        w->used = used;
+        w->cap = cap;
+    }
+    size_t i = hashval(v) & (w->cap - 1);
+    for (; w->used[i]; i = (i + 1) & (w->cap - 1))
+        if (w->val[i] == v)
+            return false;
+    w->val[i] = v;
+    w->used[i] = true;
+    w->len++;
+    return true;
+}
+
+// Breakpoint: record value, stop at first repeat
+static bool watch(RVMachine *const m, void *arg)
+{
+    Watch *const w = arg;
+    const RVWord v = m->reg[w->reg];
+    if (!setadd(w, v)) {
+        w->res->repeat = v;
+        return false;
+    }
+    if (!w->res->count++)
+        w->res->first = v;
+    w->res->last = v;
+    return true;
+}
+
+RVState rv_cycle(RVMachine *const m, const int at, const int reg, RVCycle *const res)
+{
+    *res = (RVCycle){0};
+    if (at < 0 || at >= m->size || reg < 0 || reg >= RV_REGS)
+        return RV_STATE_ERR;
+    Watch w = {.reg = reg, .ok = true, .res = res};
+    bool (*const onbreak)(RVMachine *const, void *) = m->onbreak;
+    const int brk = m->brk;
+    void *const brkarg = m->brkarg;
+    rv_break(m, at, watch);
+    m->brkarg = &w;
+    RVState state = rv_run(m);
+    rv_break(m, brk, onbreak);
+    m->brkarg = brkarg;
+    free(w.val);
+    free(w.used);
+    if (!w.ok)
+        state = m->state = RV_STATE_ERR;
+    return state;
+}
+
+////////// Listing ////////////////////////////////////////////////////////////
+
+// Operand as text
+static int argstr(char *const buf, const size_t size, const RVArg a)
+{
+    return a.reg >= 0
+        ? snprintf(buf, size, " %c", 'a' + a.reg)
+        : snprintf(buf, size, " %lld", (long long)a.imm);
+}
+
+void rv_list(const RVMachine *const m, FILE *const f)
+{
+    for (int i = 0; i < m->size; ++i) {
+        const RVSrc *const s = &m->src[i];
+        const RVInstr *const ins = m->onbreak && i == m->brk ? &m->brkins : &m->mem[i];
+        char buf[LINELEN];
+        int len = snprintf(buf, sizeof buf, "%s", m->isa->name[s->tag]);
+        for (int j = 0; j < s->argc; ++j)
+            len += argstr(buf + len, sizeof buf - len, s->arg[j]);
+        fprintf(f, "%3d: %-20s => %s", i, buf, opname[ins->op]);
+        const RVOp op = ins->op;
+        if (op >= RV_SET && op <= RV_EQ) {
+            argstr(buf, sizeof buf, argreg(ins->dst));
+            fprintf(f, "%s =", buf);
+        }
+        if (op >= RV_SET && op <= RV_SND) {
+            argstr(buf, sizeof buf, ins->x);
+            fputs(buf, f);
+        }
+        if ((op >= RV_ADD && op <= RV_EQ) || (op >= RV_JMP && op <= RV_JEQ)) {
+            argstr(buf, sizeof buf, ins->y);
+            fputs(buf, f);
+        }
+        const bool fused = op >= RV_ADDLOOP && op <= RV_DIVSUM;
+        if (op == RV_JEQ || (fused && op <= RV_QUOTIENT))
+            fprintf(f, " k=%lld", (long long)ins->k);
+        if (op == RV_RCV || fused) {
+            argstr(buf, sizeof buf, argreg(ins->dst));
+            fprintf(f, " ->%s", buf);
+        }
+        if (fused) {
+            argstr(buf, sizeof buf, ins->x);
+            fprintf(f, " x=%s", buf + 1);
+            if (op == RV_MULLOOP || op >= RV_DIVTEST) {
+                argstr(buf, sizeof buf, ins->y);
+                fprintf(f, " y=%s", buf + 1);
+            }
+            if (op >= RV_MULLOOP)
+                fprintf(f, " aux=%c", 'a' + ins->aux);
+            if (op >= RV_DIVTEST)
+                fprintf(f, " lim=%c", 'a' + ins->lim);
+            fprintf(f, " (%d lines)", ins->len);
+        }
+        fputc('\n', f);
+    }
+}
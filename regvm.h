@@ -0,0 +1,197 @@
+/**
+ * REGISTER MACHINE TOOLKIT
+ * Shared core for the small register machines of several years:
+ * Assembunny (2016), Elfcode (2018), Duet (2017) and the Turing lock (2015).
+ * Freeware. No pull requests accepted.
+ * https://github.com/ednl
+ *
+ * Every instruction set (ISA) only parses its mnemonics and lowers each
+ * source line to one generic instruction. The core then runs a peephole
+ * optimiser that replaces counting loops (add, multiply, divide) by one
+ * fused instruction, and executes the result. Source lines and lowered
+ * instructions are 1:1, so relative jumps and self-modifying programs keep
+ * working: a fused instruction only replaces the first line of its loop,
+ * and a modified line is lowered again with the loops around it. Elfcode
+ * idioms are recognised the same way: the quotient search by repeated
+ * multiplication, and the nested loops that test or sum divisors.
+ *
+ * Usage:
+ *     static RVMachine m;  // must start zeroed (static, or = {0})
+ *     rv_load(&m, &rv_assembunny, "../aocinput/2016-12-input.txt", true);
+ *     rv_reset(&m);
+ *     m.reg[2] = 1;
+ *     rv_run(&m);  // until halt, waiting for input, breakpoint or error
+ *     printf("%"PRId64"\n", m.reg[0]);
+ *     rv_free(&m);
+ * Compile:
+ *     cc -std=c17 -Wall -Wextra -pedantic ../regvm.c 12.c
+ */
+
+#ifndef REGVM_H
+#define REGVM_H
+
+#include <stdio.h>    // FILE
+#include <stdint.h>   // int64_t
+#include <stdbool.h>  // bool
+
+#define RV_REGS 26  // max register count (Duet: a-z)
+
+typedef int64_t RVWord;
+
+// Generic instructions that every ISA lowers to; fused loops come from the optimiser
+typedef enum rvop {
+    RV_NOP,                      // no operation
+    RV_SET,                      // dst = x
+    RV_ADD, RV_SUB, RV_MUL,      // dst = x OP y
+    RV_DIV, RV_MOD,              // dst = x OP y, error if y=0
+    RV_AND, RV_OR, RV_SHR,       // dst = x OP y
+    RV_GT, RV_EQ,                // dst = x OP y ? 1 : 0
+    RV_JMP,                      // ip += x + y
+    RV_JABS,                     // ip = x + y
+    RV_JNZ, RV_JGZ,              // if x != 0 / x > 0 then ip += y
+    RV_JEV, RV_JEQ,              // if x is even / x == k then ip += y
+    RV_SND,                      // push x to output queue, if any
+    RV_RCV,                      // pop input queue to dst, or wait
+    RV_EXT,                      // ISA specific, handled by isa->ext()
+    RV_ADDLOOP,                  // dst += k * x; x = 0                  (do-while loop)
+    RV_SUBLOOP,                  // dst += k * x; x = 0                  (while loop)
+    RV_MULLOOP,                  // dst += k * x * y; aux = 0; y = 0
+    RV_DIVLOOP,                  // dst += x / k; aux = k - x % k; x = 0
+    RV_QUOTIENT,                 // dst = x / k; aux = 1                 (search by multiplication)
+    RV_DIVTEST,                  // dst += x if x*q == lim for some q in y..lim; y = lim + 1; aux = 1
+    RV_DIVSUM,                   // dst += sum of divisors of lim; x = y = lim + 1; aux = 1
+    RV_BRK,                      // breakpoint, see rv_break()
+    RV_OPCOUNT
+} RVOp;
+
+typedef enum rvstate {
+    RV_STATE_OK,   // ready to run
+    RV_STATE_RCV,  // waiting at RCV for input queue to fill
+    RV_STATE_HLT,  // halted: instruction pointer outside the program
+    RV_STATE_BRK,  // stopped by breakpoint or trace function
+    RV_STATE_ERR,  // halted after error
+} RVState;
+
+// Operand: register index, or immediate value if reg < 0
+typedef struct rvarg {
+    int reg;
+    RVWord imm;
+} RVArg;
+
+// Parsed source line: ISA specific tag (index of mnemonic) and arguments
+// Single lowercase letters are registers, everything else is a number
+typedef struct rvsrc {
+    int tag, argc;
+    RVArg arg[3];
+} RVSrc;
+
+// Lowered instruction, all jumps are relative to the instruction
+typedef struct rvinstr {
+    RVOp op;
+    int dst;     // destination register
+    RVArg x, y;  // source operands, or condition and jump offset
+    int aux;     // fused loops: inner loop or flag register
+    int lim;     // fused loops: register with upper limit
+    RVWord k;    // JEQ: value to compare; fused loops: factor or divisor
+    int len;     // fused loops: number of source lines replaced
+} RVInstr;
+
+// Growing queue of values, counts every value ever pushed
+typedef struct rvqueue {
+    RVWord *q;
+    int cap, len, pop, ins;
+    int64_t total;
+} RVQueue;
+
+typedef struct rvmachine RVMachine;
+
+// Instruction set: mnemonics, lowering of one source line, optional
+// handler for RV_EXT that may change m->src[] and call rv_recompile()
+typedef struct rvisa {
+    const char *const *name;
+    int tags;
+    bool (*lower)(const RVMachine *const m, const RVSrc *const src, const int at, RVInstr *const ins);
+    bool (*ext)(RVMachine *const m, const RVInstr *const ins);
+} RVIsa;
+
+struct rvmachine {
+    const RVIsa *isa;
+    RVSrc *src;       // parsed program
+    RVInstr *orig;    // lowered program
+    RVInstr *mem;     // lowered and optimised program
+    int size, ipreg;  // program size, register bound to ip (Elfcode) or -1
+    bool optimise;    // replace loops by fused instructions
+    RVWord reg[RV_REGS];
+    int ip;
+    RVState state;
+    int64_t ticks;    // instructions executed, fused loop counts as one
+    RVQueue *inp, *out;
+    // Called before every instruction if not NULL, return false to stop
+    bool (*trace)(RVMachine *const m, const RVInstr *const ins, void *arg);
+    void *arg;        // for trace
+    // Breakpoint: called when ip reaches 'brk', return false to stop
+    bool (*onbreak)(RVMachine *const m, void *arg);
+    void *brkarg;     // for onbreak
+    int brk;
+    RVInstr brkins;   // instruction replaced by the breakpoint
+    bool brkstop;     // RV_STATE_BRK: stopped by onbreak, not by trace
+};
+
+// Values of one register every time ip reaches one instruction, until the
+// first value that was seen before (e.g. the hash loop of 2018 day 21)
+typedef struct rvcycle {
+    RVWord first;    // first value
+    RVWord last;     // last new value before the first repeat
+    RVWord repeat;   // first value seen twice = start of the cycle
+    int64_t count;   // number of different values
+} RVCycle;
+
+// Built-in instruction sets
+extern const RVIsa rv_assembunny;  // 2016 days 12, 23, 25: cpy inc dec jnz tgl out
+extern const RVIsa rv_elfcode;     // 2018 days 16, 19, 21: addr..eqri, "#ip n"
+extern const RVIsa rv_duet;        // 2017 days 18, 23: set add sub mul mod jgz jnz snd rcv
+extern const RVIsa rv_turing;      // 2015 day 23: hlf tpl inc jmp jie jio
+
+// Parse program from file, lower and optionally optimise
+// Return: false on file or syntax error
+extern bool rv_load(RVMachine *const m, const RVIsa *const isa, const char *const fname, const bool optimise);
+
+// Use program from array of source lines, lower and optionally optimise
+// Elfcode: set m->ipreg first (-1 = no register bound to ip)
+extern bool rv_setsrc(RVMachine *const m, const RVIsa *const isa, const RVSrc *const src, const int size, const bool optimise);
+
+// Lower and optimise m->src[] again, after modifying it
+extern bool rv_compile(RVMachine *const m);
+
+// Same, after modifying only line 'at': lowers that line and matches again
+// only the loops that can include it, for self-modifying programs
+extern bool rv_recompile(RVMachine *const m, const int at);
+
+// Zero registers, ip=0, keep program, queues and breakpoint
+extern void rv_reset(RVMachine *const m);
+
+// Stop at instruction 'at' and call 'onbreak' with m->brkarg every time (NULL = remove)
+// A stopped machine resumes at the same instruction without calling the
+// function that stopped it again
+extern void rv_break(RVMachine *const m, const int at, bool (*onbreak)(RVMachine *const m, void *arg));
+
+// Run until halt, waiting for input, breakpoint/trace stop, or error
+extern RVState rv_run(RVMachine *const m);
+
+// Run and watch register 'reg' at instruction 'at' until its value repeats
+// Uses (and then restores) the breakpoint. Return: RV_STATE_BRK if a
+// repeat was found, else the state where the machine stopped
+extern RVState rv_cycle(RVMachine *const m, const int at, const int reg, RVCycle *const res);
+
+// Queue management
+extern bool rv_push(RVQueue *const q, const RVWord val);
+extern bool rv_pop(RVQueue *const q, RVWord *const val);
+extern void rv_qfree(RVQueue *const q);
+
+// List program, lowered and optimised instructions side by side
+extern void rv_list(const RVMachine *const m, FILE *const f);
+
+// Free program memory, machine can be loaded again
+extern void rv_free(RVMachine *const m);
+
+#endif
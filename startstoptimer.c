@@ -1,5 +1,20 @@
+#if __linux__
+    #define _GNU_SOURCE  // must come before all includes: syscall
+    #include <unistd.h>               // syscall, read, close
+    #include <sys/ioctl.h>            // ioctl
+    #include <sys/syscall.h>          // SYS_perf_event_open
+    #include <linux/perf_event.h>     // perf_event_attr
+#endif
 #include <stdio.h>
+#include <stdlib.h>     // getenv, calloc, atexit
+#include <stdint.h>     // uint64_t
+#include <string.h>     // strcmp
+#include <stdbool.h>    // bool
+#include <stdatomic.h>  // atomic_flag, _Atomic
 #include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>  // __rdtsc
+#endif
 #include "startstoptimer.h"
 
 // CLOCK_MONOTONIC_RAW is a Linux/Darwin extension so it might not be available
@@ -18,8 +33,121 @@
 #define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
 #endif
 
+#define SST_MAXNODES 256  // named regions per thread
+#define SST_MAXDEPTH  32  // nesting depth of regions
+
 static struct timespec sst_t0, sst_t1;
 
+#if __linux__
+// Hardware counters via perf_event, only with SST_VERBOSE set
+enum { SST_CYCLES, SST_INSTR, SST_CACHEMISS, SST_COUNTERS };
+static int sst_perf[SST_COUNTERS] = {-1, -1, -1};
+static bool sst_perfon;
+static long sst_perfstops;  // timed intervals counted, reported once at exit
+#endif
+
+// One named region in the tree of a thread
+typedef struct sst_node {
+    const char *name;
+    int parent, child, next;  // tree links as indices, -1 = none
+    uint64_t ticks, count;    // accumulated
+} SstNode;
+
+// Region tree of one thread, in a global list so all can be reported at exit
+typedef struct sst_tree {
+    struct sst_tree *next;
+    int nodes, depth, id;
+    int skipped;                   // regions begun but not recorded (too deep or too many)
+    int open[SST_MAXDEPTH];        // stack of open regions
+    uint64_t start[SST_MAXDEPTH];  // start tick of open regions
+    uint64_t tick0;                // for calibration: ticks and time at creation
+    struct timespec time0;
+    SstNode node[SST_MAXNODES];    // node[0] is the root
+} SstTree;
+
+static _Thread_local SstTree *sst_tree;
+static SstTree *_Atomic sst_trees;
+static atomic_int sst_threads;
+static atomic_flag sst_atexit = ATOMIC_FLAG_INIT;
+
+static bool sst_verbose(void)
+{
+    const char *s = getenv("SST_VERBOSE");
+    return s && *s && *s != '0';
+}
+
+// CPU tick counter, or nanoseconds if none available
+static inline uint64_t sst_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t t;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+    return (uint64_t)t.tv_sec * UINT64_C(1000000000) + (uint64_t)t.tv_nsec;
+#endif
+}
+
+// Nanoseconds between two times
+static double sst_ns(const struct timespec *const t0, const struct timespec *const t1)
+{
+    return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+#if __linux__
+static void sst_perf_open(void)
+{
+    static const uint64_t config[SST_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+    for (int i = 0; i < SST_COUNTERS; ++i) {
+        if (sst_perf[i] < 0) {
+            struct perf_event_attr attr = {
+                .type = PERF_TYPE_HARDWARE, .size = sizeof attr, .config = config[i],
+                .disabled = 1, .exclude_kernel = 1, .exclude_hv = 1};
+            sst_perf[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+        if (sst_perf[i] >= 0) {
+            ioctl(sst_perf[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(sst_perf[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+// Count only between (re)start and stop
+static void sst_perf_enable(const bool on)
+{
+    for (int i = 0; i < SST_COUNTERS; ++i)
+        if (sst_perf[i] >= 0)
+            ioctl(sst_perf[i], on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+}
+
+// Totals over all timed intervals, at exit
+static void sst_perf_report(void)
+{
+    static const char *const name[SST_COUNTERS] = {"cycles", "instructions", "cache misses"};
+    uint64_t val[SST_COUNTERS] = {0};
+    bool any = false;
+    for (int i = 0; i < SST_COUNTERS; ++i)
+        if (sst_perf[i] >= 0 && read(sst_perf[i], &val[i], sizeof val[i]) == sizeof val[i])
+            any = true;
+    if (!any) {
+        fputs("Perf: no hardware counters (check /proc/sys/kernel/perf_event_paranoid).\n", stderr);
+        return;
+    }
+    fprintf(stderr, "Perf (%ld stop%s):", sst_perfstops, sst_perfstops == 1 ? "" : "s");
+    for (int i = 0; i < SST_COUNTERS; ++i)
+        if (sst_perf[i] >= 0)
+            fprintf(stderr, " %llu %s", (unsigned long long)val[i], name[i]);
+    if (val[SST_CYCLES])
+        fprintf(stderr, " (IPC %.2f)", (double)val[SST_INSTR] / val[SST_CYCLES]);
+    fputc('\n', stderr);
+}
+#endif
+
 // Record current time as stop time
 // Return difference to start time in seconds with specified factor
 static double sst_stop(const double factor)
@@ -27,6 +155,12 @@ static double sst_stop(const double factor)
     clock_gettime(CLOCK_MONOTONIC_RAW, &sst_t1);
     const double dsec  = (sst_t1.tv_sec  - sst_t0.tv_sec ) * factor;
     const double dnano = (sst_t1.tv_nsec - sst_t0.tv_nsec) * factor * 1e-9;
+#if __linux__
+    if (sst_perfon) {
+        sst_perf_enable(false);
+        sst_perfstops++;
+    }
+#endif
     return dsec + dnano;
 }
 
@@ -43,6 +177,40 @@ void starttimer(void)
                 "  Setting will be restored to default 'ondemand' at reboot.\n");
         fclose(f);
     }
+#if __linux__
+    if (sst_verbose()) {
+        // Current and maximum frequency in kHz, to compare runtimes from different machines
+        long cur = 0, max = 0;
+        if ((f = fopen("/sys/devices/system/cpu/cpufreq/policy0/scaling_cur_freq", "r"))) {
+            if (fscanf(f, "%ld", &cur) != 1) cur = 0;
+            fclose(f);
+        }
+        if ((f = fopen("/sys/devices/system/cpu/cpufreq/policy0/cpuinfo_max_freq", "r"))) {
+            if (fscanf(f, "%ld", &max) != 1) max = 0;
+            fclose(f);
+        }
+        if (cur)
+            fprintf(stderr, "CPU frequency: %.0f MHz (max %.0f MHz)\n", cur / 1e3, max / 1e3);
+        else
+            fputs("CPU frequency: unknown\n", stderr);
+        if (!sst_perfon)
+            atexit(sst_perf_report);
+        sst_perf_open();
+        sst_perfstops = 0;
+        sst_perfon = true;
+    }
+#endif
+    clock_gettime(CLOCK_MONOTONIC_RAW, &sst_t0);
+}
+
+// Record current time as start time, without the performance check
+// For repeated measurements, e.g. by the benchmark harness
+void resettimer(void)
+{
+#if __linux__
+    if (sst_perfon)
+        sst_perf_enable(true);
+#endif
     clock_gettime(CLOCK_MONOTONIC_RAW, &sst_t0);
 }
 
@@ -69,3 +237,101 @@ double stoptimer_s(void)
 {
     return sst_stop(1.0);
 }
+
+// Print region tree depth-first, flame graph style: children indented under parent
+static void sst_print(const SstTree *const t, const int i, const int level, const double nspertick)
+{
+    const SstNode *const n = &t->node[i];
+    if (i) {
+        const double parent = n->parent ? t->node[n->parent].ticks : 0;
+        fprintf(stderr, "%12.3f us", n->ticks * nspertick * 1e-3);
+        if (parent)
+            fprintf(stderr, " %5.1f%%", 100.0 * n->ticks / parent);
+        else
+            fputs("       ", stderr);
+        fprintf(stderr, " %8llux  %*s%s\n", (unsigned long long)n->count, level * 2, "", n->name);
+    }
+    for (int c = n->child; c >= 0; c = t->node[c].next)
+        sst_print(t, c, level + !!i, nspertick);
+}
+
+// Summary of all regions of all threads at exit
+static void sst_report(void)
+{
+    const uint64_t tick1 = sst_ticks();
+    struct timespec time1;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &time1);
+    for (const SstTree *t = atomic_load(&sst_trees); t; t = t->next) {
+        // Calibrate ticks against clock over the lifetime of the tree
+        const double dt = sst_ns(&t->time0, &time1);
+        const double nspertick = tick1 > t->tick0 && dt > 0 ? dt / (double)(tick1 - t->tick0) : 1;
+        fprintf(stderr, "Regions thread %d (%.3f ns/tick):\n", t->id, nspertick);
+        sst_print(t, 0, 0, nspertick);
+    }
+}
+
+// Region tree of this thread, created on first use
+static SstTree *sst_mytree(void)
+{
+    if (sst_tree)
+        return sst_tree;
+    SstTree *t = calloc(1, sizeof *t);
+    if (!t)
+        return NULL;
+    t->node[0] = (SstNode){.name = "", .parent = -1, .child = -1, .next = -1};
+    t->nodes = 1;
+    t->id = atomic_fetch_add(&sst_threads, 1);
+    clock_gettime(CLOCK_MONOTONIC_RAW, &t->time0);
+    t->tick0 = sst_ticks();
+    t->next = atomic_load(&sst_trees);
+    while (!atomic_compare_exchange_weak(&sst_trees, &t->next, t));
+    if (!atomic_flag_test_and_set(&sst_atexit))
+        atexit(sst_report);
+    return sst_tree = t;
+}
+
+void sst_begin(const char *const name)
+{
+    SstTree *const t = sst_mytree();
+    if (!t)
+        return;
+    if (t->skipped || t->depth == SST_MAXDEPTH) {
+        t->skipped++;  // so that the matching sst_end() is also skipped
+        return;
+    }
+    const int parent = t->depth ? t->open[t->depth - 1] : 0;
+    int i = t->node[parent].child, last = -1;
+    while (i >= 0 && t->node[i].name != name && strcmp(t->node[i].name, name))
+        i = t->node[last = i].next;
+    if (i < 0) {
+        if (t->nodes == SST_MAXNODES) {
+            t->skipped++;
+            return;
+        }
+        i = t->nodes++;
+        t->node[i] = (SstNode){.name = name, .parent = parent, .child = -1, .next = -1};
+        if (last < 0)
+            t->node[parent].child = i;
+        else
+            t->node[last].next = i;  // keep siblings in order of first use
+    }
+    t->open[t->depth] = i;
+    t->start[t->depth++] = sst_ticks();  // last, to not time the bookkeeping
+}
+
+void sst_end(void)
+{
+    const uint64_t now = sst_ticks();  // first, to not time the bookkeeping
+    SstTree *const t = sst_tree;
+    if (!t)
+        return;
+    if (t->skipped) {
+        t->skipped--;
+        return;
+    }
+    if (!t->depth)
+        return;
+    SstNode *const n = &t->node[t->open[--t->depth]];
+    n->ticks += now - t->start[t->depth];
+    n->count++;
+}
@@ -5,6 +5,10 @@
 // Warn on Raspberry Pi if not running at max performance
 void starttimer(void);
 
+// Record current time as start time, without the performance check
+// For repeated measurements, e.g. by the benchmark harness
+void resettimer(void);
+
 // Time difference in nanoseconds between now and last call to starttimer()
 double stoptimer_ns(void);
 
@@ -17,4 +21,27 @@ double stoptimer_ms(void);
 // Time difference in seconds between now and last call to starttimer()
 double stoptimer_s(void);
 
+// Named timing regions: nestable, separate for every thread.
+// Regions with the same name under the same parent are accumulated.
+// A summary of all regions of all threads, as an indented tree with total
+// time, share of parent and call count, is printed to stderr at exit.
+// Uses the CPU cycle/tick counter where available (x86 TSC, ARM64 virtual
+// counter), calibrated against CLOCK_MONOTONIC_RAW; otherwise that clock.
+// Example:
+//   sst_begin("parse"); parse(); sst_end();
+//   sst_begin("solve");
+//     sst_begin("part1"); part1(); sst_end();
+//     sst_begin("part2"); part2(); sst_end();
+//   sst_end();
+// Name must be a string literal or otherwise stay valid until exit.
+void sst_begin(const char *const name);
+
+// End the most recently begun region of this thread.
+void sst_end(void);
+
+// Set environment variable SST_VERBOSE=1 for extra info on stderr:
+//   starttimer() reports CPU frequency and governor (Linux), and at exit the
+//   cycles, instructions and cache misses via perf_event (Linux) are reported
+//   once, summed over all intervals from (re)start to stop.
+
 #endif  // STARTSTOPTIMER_H
@@ -1,7 +1,67 @@
+#include <stdio.h>
+#include <string.h>
 #include "mymd5.h"
 
 int main(void)
 {
     mymd5_print("12345678901234567890123456789012345678901234567890123456"); // 49f193adce178490e34d1b3a4ec0064c
-    return 0;
+
+    // Batch hashing must agree with one-at-a-time hashing
+    static const char *msg[] = {
+        "", "a", "abc", "message digest", "abcdefghijklmnopqrstuvwxyz",
+        "iwrupvqb346386", "ojvtpuvg1469591", "zpqevtbw0", "udskfozmDDRR",
+        "1234567890123456789012345678901234567890123456789012345",
+        "12345678901234567890123456789012345678901234567890123456",
+        "0", "1", "2", "3", "4", "5", "6", "7", "8", "9"};
+    enum { N = sizeof msg / sizeof *msg };
+    uint32_t sum[N][4];
+    mymd5_batch(msg, sum, N);
+    int fail = 0;
+    for (int i = 0; i < N; ++i) {
+        char a[33], b[33];
+        mymd5(msg[i], a);
+        mymd5_hex(sum[i], b);
+        if (strcmp(a, b)) {
+            printf("Batch mismatch \"%s\": %s != %s\n", msg[i], b, a);
+            fail = 1;
+        }
+    }
+
+    // Salted counter must agree with rendering the whole message
+    Md5Salt ctx;
+    const char *salts[] = {"", "abc", "iwrupvqb", "abcdefghijklmnopqrstuvwxyz0123456789"};
+    const uint64_t starts[] = {0, 9, 95, 999990, 9999999999999999980u};
+    for (size_t s = 0; s < sizeof salts / sizeof *salts; ++s)
+        for (size_t t = 0; t < sizeof starts / sizeof *starts; ++t) {
+            uint32_t batch[40][4];
+            mymd5_salt_init(&ctx, salts[s], starts[t]);
+            mymd5_salt_batch(&ctx, batch, 40);
+            for (int i = 0; i < 40; ++i) {
+                char m[64], a[33], b[33];
+                snprintf(m, sizeof m, "%.35s%llu", salts[s], (unsigned long long)(starts[t] + (uint64_t)i));
+                mymd5(m, a);
+                mymd5_hex(batch[i], b);
+                if (strcmp(a, b)) {
+                    printf("Salted mismatch \"%s\": %s != %s\n", m, b, a);
+                    fail = 1;
+                }
+            }
+        }
+
+    // Key stretching must agree with repeated hashing of hex strings
+    uint32_t stretched[20][4];
+    mymd5_salt_init(&ctx, "abc", 0);
+    mymd5_salt_stretch(&ctx, stretched, 20, 2017);
+    for (int i = 0; i < 20; ++i) {
+        char m[64], b[33];
+        snprintf(m, sizeof m, "abc%d", i);
+        mymd5_stretch(m, 2017);
+        mymd5_hex(stretched[i], b);
+        if (strcmp(m, b)) {
+            printf("Stretch mismatch abc%d: %s != %s\n", i, b, m);
+            fail = 1;
+        }
+    }
+    printf("Batch lanes: %d %s\n", mymd5_lanes(), fail ? "FAIL" : "ok");
+    return fail;
 }
@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include "regvm.h"
+
+// Assembunny: cpy inc dec jnz tgl out
+enum { CPY, INC, DEC, JNZ, TGL };
+#define REG(r) {.reg = (r) - 'a'}
+#define IMM(v) {.reg = -1, .imm = (v)}
+#define BRK 1  // breakpoint at "inc b"
+#define MAXSTOPS 16
+
+// Elfcode: every argument is a number, registers 0-5 with ip bound to 4
+enum { ADDR, ADDI, MULR, MULI, BANR, BANI, BORR, BORI, SETR, SETI, GTRR, GTIR, GTRI, EQRR, EQIR, EQRI };
+enum { A, B, C, D, IP, F };
+#define ELF(t, x, y, z) {t, 3, {IMM(x), IMM(y), IMM(z)}}
+#define INREGS 6  // registers set by a test input
+
+static const RVSrc prog[] = {
+    {CPY, 2, {IMM(3), REG('a')}},
+    {INC, 1, {REG('b')}},
+    {DEC, 1, {REG('a')}},
+    {JNZ, 2, {REG('a'), IMM(-2)}},
+};
+
+// One loop for every pattern of the optimiser, first line at 'at' is fused to 'op'
+static const RVSrc addloop[] = {
+    {INC, 1, {REG('a')}},
+    {DEC, 1, {REG('c')}},
+    {JNZ, 2, {REG('c'), IMM(-2)}},
+};
+static const RVSrc subloop[] = {
+    {JNZ, 2, {REG('c'), IMM(2)}},
+    {JNZ, 2, {IMM(1), IMM(4)}},
+    {DEC, 1, {REG('b')}},
+    {DEC, 1, {REG('c')}},
+    {JNZ, 2, {IMM(1), IMM(-4)}},
+};
+static const RVSrc mulloop[] = {
+    {CPY, 2, {REG('b'), REG('c')}},
+    {INC, 1, {REG('a')}},
+    {DEC, 1, {REG('c')}},
+    {JNZ, 2, {REG('c'), IMM(-2)}},
+    {DEC, 1, {REG('d')}},
+    {JNZ, 2, {REG('d'), IMM(-5)}},
+};
+static const RVSrc divloop[] = {
+    {CPY, 2, {IMM(3), REG('c')}},
+    {JNZ, 2, {REG('b'), IMM(2)}},
+    {JNZ, 2, {IMM(1), IMM(6)}},
+    {DEC, 1, {REG('b')}},
+    {DEC, 1, {REG('c')}},
+    {JNZ, 2, {REG('c'), IMM(-4)}},
+    {INC, 1, {REG('a')}},
+    {JNZ, 2, {IMM(1), IMM(-7)}},
+};
+// Add loop only appears after toggling: "cpy b -2" is invalid until it becomes "jnz b -2"
+static const RVSrc toggle[] = {
+    {TGL, 1, {IMM(3)}},
+    {INC, 1, {REG('a')}},
+    {DEC, 1, {REG('b')}},
+    {CPY, 2, {REG('b'), IMM(-2)}},
+};
+static const RVSrc quotient[] = {
+    ELF(SETI, 0, 0, D),
+    ELF(ADDI, D, 1, C),
+    ELF(MULI, C, 7, C),
+    ELF(GTRR, C, B, C),
+    ELF(ADDR, C, IP, IP),
+    ELF(ADDI, IP, 1, IP),
+    ELF(ADDI, IP, 2, IP),
+    ELF(ADDI, D, 1, D),
+    ELF(SETI, 0, 0, IP),
+};
+static const RVSrc divtest[] = {
+    ELF(SETI, 0, 0, D),
+    ELF(MULR, F, B, D),
+    ELF(EQRR, D, C, D),
+    ELF(ADDR, D, IP, IP),
+    ELF(ADDI, IP, 1, IP),
+    ELF(ADDR, F, A, A),
+    ELF(ADDI, B, 1, B),
+    ELF(GTRR, B, C, D),
+    ELF(ADDR, D, IP, IP),
+    ELF(SETI, 0, 0, IP),
+};
+static const RVSrc divsum[] = {
+    ELF(SETI, 0, 0, D),
+    ELF(SETI, 1, 0, F),
+    ELF(SETI, 1, 0, B),
+    ELF(MULR, F, B, D),
+    ELF(EQRR, D, C, D),
+    ELF(ADDR, D, IP, IP),
+    ELF(ADDI, IP, 1, IP),
+    ELF(ADDR, F, A, A),
+    ELF(ADDI, B, 1, B),
+    ELF(GTRR, B, C, D),
+    ELF(ADDR, D, IP, IP),
+    ELF(SETI, 2, 0, IP),
+    ELF(ADDI, F, 1, F),
+    ELF(GTRR, F, C, D),
+    ELF(ADDR, D, IP, IP),
+    ELF(SETI, 1, 0, IP),
+};
+
+typedef struct pattern {
+    const char *name;
+    const RVIsa *isa;
+    int ipreg;
+    const RVSrc *src;
+    int size, at;
+    RVOp op;
+} Pattern;
+
+#define PAT(name, isa, ipreg, at, op) {#name, &isa, ipreg, name, sizeof name / sizeof *name, at, op}
+enum { ADDLOOP, SUBLOOP, MULLOOP, DIVLOOP, TOGGLE, QUOTIENT, DIVTEST, DIVSUM };
+static const Pattern pattern[] = {
+    PAT(addloop , rv_assembunny, -1, 0, RV_ADDLOOP),
+    PAT(subloop , rv_assembunny, -1, 0, RV_SUBLOOP),
+    PAT(mulloop , rv_assembunny, -1, 0, RV_MULLOOP),
+    PAT(divloop , rv_assembunny, -1, 0, RV_DIVLOOP),
+    PAT(toggle  , rv_assembunny, -1, 1, RV_ADDLOOP),
+    PAT(quotient, rv_elfcode   , IP, 0, RV_QUOTIENT),
+    PAT(divtest , rv_elfcode   , IP, 1, RV_DIVTEST),
+    PAT(divsum  , rv_elfcode   , IP, 1, RV_DIVSUM),
+};
+
+// Start registers; fallback = precondition fails, so the original line runs.
+// Loops that would not end are stopped at a number of visits of one line.
+typedef struct input {
+    int pat;
+    RVWord reg[INREGS];
+    bool fallback;
+    int line, visits;  // visits = 0: run to halt
+} Input;
+
+static const Input input[] = {
+    {ADDLOOP , {[A] = 1, [C] = 5}, false, 0, 0},
+    {ADDLOOP , {[A] = 1, [C] = 0}, true, 0, 10},   // n <= 0
+    {ADDLOOP , {[A] = 1, [C] = -3}, true, 0, 10},
+    {SUBLOOP , {[B] = 10, [C] = 3}, false, 0, 0},
+    {SUBLOOP , {[B] = 10, [C] = 0}, false, 0, 0},
+    {SUBLOOP , {[B] = 10, [C] = -1}, true, 0, 10},  // n < 0
+    {MULLOOP , {[A] = 1, [B] = 3, [D] = 4}, false, 0, 0},
+    {MULLOOP , {[A] = 1, [B] = 0, [D] = 4}, true, 1, 10},  // n <= 0
+    {MULLOOP , {[A] = 1, [B] = 3, [D] = 0}, true, 0, 10},  // outer <= 0
+    {DIVLOOP , {[B] = 17}, false, 0, 0},
+    {DIVLOOP , {[B] = 0}, false, 0, 0},
+    {DIVLOOP , {[B] = -1}, true, 0, 10},  // n < 0
+    {TOGGLE  , {[B] = 4}, false, 0, 0},
+    {QUOTIENT, {[B] = 100}, false, 0, 0},
+    {QUOTIENT, {[B] = 0}, false, 0, 0},
+    {QUOTIENT, {[B] = -10}, true, 0, 0},  // n < 0
+    {DIVTEST , {[B] = 1, [C] = 12, [F] = 3}, false, 0, 0},
+    {DIVTEST , {[B] = 4, [C] = 12, [F] = 4}, false, 0, 0},  // quotient 3 < b
+    {DIVTEST , {[B] = 13, [C] = 12, [F] = 3}, true, 0, 0},  // b > lim
+    {DIVTEST , {[B] = 1, [C] = 12, [F] = 0}, true, 0, 0},   // f <= 0
+    {DIVSUM  , {[C] = 36}, false, 0, 0},
+    {DIVSUM  , {[C] = 0}, true, 0, 0},  // n <= 0
+    {DIVSUM  , {[C] = -3}, true, 0, 0},
+};
+
+typedef struct pass {
+    int at, left;
+} Pass;
+
+typedef struct trace {
+    int64_t calls;
+    int stopat;  // stop once at this ip, -1 = never
+    bool sawbrk;
+} Trace;
+
+typedef struct stops {
+    int64_t ticks[MAXSTOPS];
+    int len;
+} Stops;
+
+static RVMachine m;
+
+static bool trace(RVMachine *const vm, const RVInstr *const ins, void *arg)
+{
+    Trace *const t = arg;
+    t->calls++;
+    t->sawbrk |= ins->op == RV_BRK;
+    if (vm->ip == t->stopat) {
+        t->stopat = -1;
+        return false;
+    }
+    return true;
+}
+
+static bool onbreak(RVMachine *const vm, void *arg)
+{
+    Stops *const s = arg;
+    if (s->len < MAXSTOPS)
+        s->ticks[s->len++] = vm->ticks;
+    return false;
+}
+
+// Stop at the last of a number of visits of one line
+static bool passes(RVMachine *const vm, const RVInstr *const ins, void *arg)
+{
+    (void)ins;
+    Pass *const p = arg;
+    return vm->ip != p->at || --p->left > 0;
+}
+
+// Run to halt, resume after every breakpoint or trace stop
+static void runall(Stops *const s)
+{
+    *s = (Stops){0};
+    m.brkarg = s;
+    rv_reset(&m);
+    for (int i = 0; i < MAXSTOPS && rv_run(&m) == RV_STATE_BRK; ++i);
+}
+
+// Run one input on the program of its pattern, with or without fused loops
+static bool runpat(const Input *const in, const bool optimise)
+{
+    const Pattern *const p = &pattern[in->pat];
+    m.ipreg = p->ipreg;
+    if (!rv_setsrc(&m, p->isa, p->src, p->size, optimise))
+        return false;
+    rv_reset(&m);
+    for (int i = 0; i < INREGS; ++i)
+        m.reg[i] = in->reg[i];
+    Pass pass = {in->line, in->visits};
+    m.trace = in->visits ? passes : NULL;
+    m.arg = &pass;
+    rv_run(&m);
+    m.trace = NULL;
+    return true;
+}
+
+static bool same(const Stops *const a, const Stops *const b)
+{
+    if (a->len != b->len)
+        return false;
+    for (int i = 0; i < a->len; ++i)
+        if (a->ticks[i] != b->ticks[i])
+            return false;
+    return true;
+}
+
+int main(void)
+{
+    int fail = 0;
+    if (!rv_setsrc(&m, &rv_assembunny, prog, sizeof prog / sizeof *prog, false)) {
+        puts("Setup FAIL");
+        return 1;
+    }
+    rv_break(&m, BRK, onbreak);
+
+    // Breakpoint without trace: reference stops
+    Stops ref, got;
+    runall(&ref);
+    if (ref.len != 3 || m.state != RV_STATE_HLT) {
+        printf("Breakpoint: %d stops, state %d\n", ref.len, m.state);
+        fail = 1;
+    }
+
+    // Same stops with a trace that never stops, trace sees every real instruction once
+    Trace t = {.stopat = -1};
+    m.trace = trace;
+    m.arg = &t;
+    runall(&got);
+    if (!same(&ref, &got) || m.state != RV_STATE_HLT || t.calls != m.ticks || t.sawbrk) {
+        printf("Trace + breakpoint: %d stops, %lld calls, %lld ticks%s\n",
+            got.len, (long long)t.calls, (long long)m.ticks, t.sawbrk ? ", saw RV_BRK" : "");
+        fail = 1;
+    }
+
+    // Trace stops at the breakpoint first, then the breakpoint must still fire
+    t = (Trace){.stopat = BRK};
+    runall(&got);
+    if (!same(&ref, &got) || m.state != RV_STATE_HLT || t.calls != m.ticks) {
+        printf("Trace stop at breakpoint: %d stops, %lld calls, %lld ticks\n",
+            got.len, (long long)t.calls, (long long)m.ticks);
+        fail = 1;
+    }
+
+    // Cycle detection keeps the trace argument: register c is always 0
+    t = (Trace){.stopat = -1};
+    rv_reset(&m);
+    RVCycle cyc;
+    const RVState state = rv_cycle(&m, BRK, 'c' - 'a', &cyc);
+    if (state != RV_STATE_BRK || cyc.count != 1 || cyc.repeat != 0 || m.arg != &t || t.calls != m.ticks + 1) {
+        printf("Cycle with trace: state %d, count %lld, %lld calls, %lld ticks\n",
+            state, (long long)cyc.count, (long long)t.calls, (long long)m.ticks);
+        fail = 1;
+    }
+    if (m.onbreak != onbreak || m.brk != BRK) {
+        puts("Cycle did not restore breakpoint");
+        fail = 1;
+    }
+
+    // Every fused loop gives the same registers and ip as the original lines, also
+    // where its precondition fails; toggling must fuse the loop it completes
+    rv_break(&m, -1, NULL);
+    for (size_t i = 0; i < sizeof input / sizeof *input; ++i) {
+        const Input *const in = &input[i];
+        const Pattern *const p = &pattern[in->pat];
+        if (!runpat(in, false)) {
+            printf("Pattern %s, input %zu: setup FAIL\n", p->name, i);
+            fail = 1;
+            continue;
+        }
+        RVWord reg[RV_REGS];
+        for (int j = 0; j < RV_REGS; ++j)
+            reg[j] = m.reg[j];
+        const int ip = m.ip;
+        const RVState state = m.state;
+        const int64_t ticks = m.ticks;
+        const bool plain = m.mem[p->at].op != p->op;
+        if (!runpat(in, true)) {
+            printf("Pattern %s, input %zu: setup FAIL\n", p->name, i);
+            fail = 1;
+            continue;
+        }
+        bool ok = plain && m.mem[p->at].op == p->op && m.ip == ip && m.state == state
+            && (in->visits || state == RV_STATE_HLT) && (in->fallback || m.ticks < ticks);
+        for (int j = 0; j < RV_REGS; ++j)
+            ok &= m.reg[j] == reg[j];
+        if (!ok) {
+            printf("Pattern %s, input %zu: ip %d/%d, state %d/%d, ticks %lld/%lld, op %d\n", p->name, i,
+                ip, m.ip, state, m.state, (long long)ticks, (long long)m.ticks, m.mem[p->at].op);
+            fail = 1;
+        }
+    }
+
+    rv_free(&m);
+    printf("Register VM %s\n", fail ? "FAIL" : "ok");
+    return fail;
+}
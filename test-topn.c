@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "topn.h"
+
+#define NEL 10000
+
+static int data[NEL], ref[NEL], work[NEL], buf[NEL];
+
+// Descending
+static int cmp(const void *p, const void *q)
+{
+    const int a = *(const int *)p, b = *(const int *)q;
+    return (a < b) - (a > b);
+}
+
+static int check(const char *const name, const int *const got, const size_t n)
+{
+    if (!memcmp(got, ref, n * sizeof *got))
+        return 0;
+    printf("%s n=%zu: mismatch\n", name, n);
+    return 1;
+}
+
+int main(void)
+{
+    srand(2025);
+    for (int i = 0; i < NEL; ++i)
+        data[i] = rand() % (NEL / 2) - NEL / 4;  // with duplicates and negatives
+    memcpy(ref, data, sizeof ref);
+    qsort(ref, NEL, sizeof *ref, cmp);
+
+    static const size_t sizes[] = {1, 3, 10, 100, 2500, NEL};
+    int fail = 0;
+    for (size_t s = 0; s < sizeof sizes / sizeof *sizes; ++s) {
+        const size_t n = sizes[s];
+
+        memcpy(work, data, sizeof work);
+        topn(work, n, NEL, sizeof *work, cmp);
+        fail |= check("topn", work, n);
+
+        for (int threads = 0; threads <= 8; threads += 1 + (threads > 2)) {
+            memcpy(work, data, sizeof work);
+            if (topn_parallel(work, n, NEL, sizeof *work, cmp, threads)) {
+                printf("topn_parallel n=%zu threads=%d: out of memory\n", n, threads);
+                fail = 1;
+            } else
+                fail |= check("topn_parallel", work, n);
+        }
+
+        // Two streaming selectors merged, like two threads
+        TopN a, b;
+        topn_init(&a, buf, n, sizeof *buf, cmp);
+        topn_init(&b, work, n, sizeof *work, cmp);
+        for (int i = 0; i < NEL; ++i)
+            topn_push(i & 1 ? &a : &b, &data[i]);
+        topn_merge(&a, &b);
+        if (topn_sort(&a) != n) {
+            printf("TopN n=%zu: wrong length\n", n);
+            fail = 1;
+        } else
+            fail |= check("TopN", buf, n);
+
+        memcpy(work, data, sizeof work);
+        topn_int(work, n, NEL);
+        fail |= check("topn_int", work, n);
+
+        // Keys with payload pointing back at the element
+        static TopNItem item[NEL];
+        TopNKeys keys = {.item = item, .n = n};
+        for (int i = 0; i < NEL; ++i)
+            topn_keys_push(&keys, data[i], &data[i]);
+        if (topn_keys_sort(&keys) != n) {
+            printf("TopNKeys n=%zu: wrong length\n", n);
+            fail = 1;
+        } else
+            for (size_t i = 0; i < n; ++i)
+                if (item[i].key != ref[i] || *(const int *)item[i].ptr != ref[i]) {
+                    printf("TopNKeys n=%zu: mismatch at %zu\n", n, i);
+                    fail = 1;
+                    break;
+                }
+    }
+    printf("Top-N %s\n", fail ? "FAIL" : "ok");
+    return fail;
+}
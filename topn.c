@@ -1,11 +1,47 @@
-#include <stdlib.h>  // qsort, size_t
-#include <string.h>  // memmove, memcpy
+#include <stdlib.h>   // size_t
+#include <string.h>   // memcpy
 #include "topn.h"
 
+// Swap two elements of 'width' bytes
+static void swap(unsigned char *a, unsigned char *b, size_t width)
+{
+    for (; width; --width, ++a, ++b) {
+        const unsigned char t = *a;
+        *a = *b;
+        *b = t;
+    }
+}
+
+// Restore heap property from index i down, with the last element (by 'cmp') at
+// the root. Elements are moved by swapping, so no temporary buffer is needed.
+static void siftdown(unsigned char *const h, size_t i, const size_t len, const size_t width,
+                     int (*cmp)(const void *, const void *))
+{
+    for (size_t c; (c = 2 * i + 1) < len; i = c) {
+        if (c + 1 < len && cmp(h + width * c, h + width * (c + 1)) < 0)
+            ++c;
+        if (cmp(h + width * i, h + width * c) >= 0)
+            break;
+        swap(h + width * i, h + width * c, width);
+    }
+}
+
+// Sort heap of 'len' elements in place, ascending by 'cmp'
+static void heapsort(unsigned char *const h, size_t len, const size_t width,
+                     int (*cmp)(const void *, const void *))
+{
+    while (len-- > 1) {
+        swap(h, h + width * len, width);
+        siftdown(h, 0, len, width, cmp);
+    }
+}
+
 // Sort the first 'n' elements of array 'base' which has 'nel' elements of size
 // 'width'. Sorting is done using the qsort-compatible comparison function 'cmp'
 // Going in: 0 < sel <= nel, width > 0, base != NULL, cmp != NULL
 // Going out: elements outside the top 'n' are not preserved
+// The first 'n' elements are kept as a heap, so every other element costs one
+// comparison with the root, plus O(log n) if it belongs in the top 'n'.
 void topn(void *base, const size_t n, const size_t nel, const size_t width,
           int (*cmp)(const void *, const void *))
 {
@@ -13,34 +49,49 @@ void topn(void *base, const size_t n, const size_t nel, const size_t width,
     if (!n || n > nel || !width || !base || !cmp)
         return;
 
-    // Sort first 'n' elements using library function
-    qsort(base, n, width, cmp);
+    unsigned char *const h = base;
+    for (size_t i = n / 2; i-- > 0; )
+        siftdown(h, i, n, width, cmp);
+    for (size_t i = n; i < nel; ++i) {
+        unsigned char *const cur = h + width * i;
+        if (cmp(cur, h) < 0) {  // cur comes before last of top 'n'
+            memcpy(h, cur, width);
+            siftdown(h, 0, n, width, cmp);
+        }
+    }
+    heapsort(h, n, width, cmp);
+}
 
-    // Insertion sort with binary search for all other elements
-    unsigned char *const cbase = base;
-    const unsigned char *const beg = cbase + width * n;
-    const unsigned char *const end = cbase + width * nel;
-    unsigned char *const last = cbase + width * (n - 1);
-    for (const unsigned char *cur = beg; cur != end; cur += width) {
+void topn_init(TopN *const sel, void *const buf, const size_t n, const size_t width,
+               int (*cmp)(const void *, const void *))
+{
+    *sel = (TopN){.base = buf, .n = n, .len = 0, .width = width, .cmp = cmp};
+}
 
-        if (cmp(last, cur) <= 0)  // last comes before cur, or they are equal?
-            continue;  // should be most common case if n much smaller than nel
+void topn_push(TopN *const sel, const void *const elem)
+{
+    unsigned char *const h = sel->base;
+    const size_t w = sel->width;
+    if (sel->len < sel->n) {
+        // Append and sift up
+        size_t i = sel->len++;
+        memcpy(h + w * i, elem, w);
+        for (size_t p; i && sel->cmp(h + w * (p = (i - 1) / 2), h + w * i) < 0; i = p)
+            swap(h + w * p, h + w * i, w);
+    } else if (sel->n && sel->cmp(elem, h) < 0) {
+        memcpy(h, elem, w);
+        siftdown(h, 0, sel->n, w, sel->cmp);
+    }
+}
 
-        if (cmp(cur, cbase) < 0) {  // cur comes before base?
-            memmove(cbase + width, cbase, last - cbase);
-            memcpy(cbase, cur, width);
-            continue;  // should be rare but has to be checked before binsearch
-        }
+void topn_merge(TopN *const sel, const TopN *const other)
+{
+    for (size_t i = 0; i < other->len; ++i)
+        topn_push(sel, other->base + other->width * i);
+}
 
-        // Insertion point is now always after 'l', at or before 'r'
-        size_t l = 0, r = n - 1;
-        while (r - l > 1) {
-            const size_t m = ((l + 1) >> 1) + (r >> 1);  // avoid overflow, bias towards r
-            if (cmp(cur, cbase + width * m) < 0) r = m;
-            else                                 l = m;
-        }
-        unsigned char *const ins = cbase + width * r;
-        memmove(ins + width, ins, last - ins);
-        memcpy(ins, cur, width);
-    }
+size_t topn_sort(TopN *const sel)
+{
+    heapsort(sel->base, sel->len, sel->width, sel->cmp);
+    return sel->len;
 }
@@ -10,4 +10,143 @@
 void topn(void *base, const size_t n, const size_t nel, const size_t width,
           int (*cmp)(const void *, const void *));
 
+// Same as topn() but split over 'threads' threads (threads <= 0: all cores).
+// Every thread selects the top 'n' of its own slice, then these are merged.
+// Going out: elements outside the top 'n' are not preserved
+// Returns 0 on success, -1 if out of memory (then nothing is changed)
+// In its own file so that serial users need no threads, compile with:
+//     ../topn.c ../topn_parallel.c ../cores.c -lpthread
+int topn_parallel(void *base, const size_t n, const size_t nel, const size_t width,
+                  int (*cmp)(const void *, const void *), const int threads);
+
+// Streaming selector: keeps the top 'n' of all elements pushed so far in a
+// caller-supplied buffer of n elements, as a binary heap with the last of the
+// top 'n' at the root. Memory is O(n) whatever the number of elements.
+// Usage:
+//   TopN sel;
+//   topn_init(&sel, buf, n, sizeof *buf, cmp);
+//   for (...) topn_push(&sel, &elem);
+//   size_t len = topn_sort(&sel);  // buf[0..len-1] is now sorted
+typedef struct topnheap {
+    unsigned char *base;  // caller-supplied buffer of n elements
+    size_t n, len, width;
+    int (*cmp)(const void *, const void *);
+} TopN;
+
+// Set up empty selector for top 'n' elements of size 'width' in buffer 'buf'
+void topn_init(TopN *const sel, void *const buf, const size_t n, const size_t width,
+               int (*cmp)(const void *, const void *));
+
+// Offer one element: O(log n) if kept, one comparison if not
+void topn_push(TopN *const sel, const void *const elem);
+
+// Offer all elements of another selector (e.g. from another thread)
+void topn_merge(TopN *const sel, const TopN *const other);
+
+// Sort buffer in place, return number of elements (<= n)
+// NB: after this, the selector is no longer a heap; do not push any more
+size_t topn_sort(TopN *const sel);
+
+////////////////////////////////////////////////////////////////////////////////
+// Typed selectors without indirect calls to a comparison function
+////////////////////////////////////////////////////////////////////////////////
+
+// Order predicates for TOPN_DEFINE: top n are the largest or smallest
+#define TOPN_DESC(a, b) ((a) > (b))
+#define TOPN_ASC(a, b)  ((a) < (b))
+
+// Define 'static inline void NAME(TYPE *base, size_t n, size_t nel)' which
+// does the same as topn() for an array of TYPE, ordered by BEFORE(a, b) which
+// must be true if a comes before b. For example:
+//   TOPN_DEFINE(top_int16, int16_t, TOPN_DESC)
+//   top_int16(array, 3, len);  // array[0..2] = 3 largest, sorted descending
+#define TOPN_DEFINE(NAME, TYPE, BEFORE) \
+static inline void NAME##_sift(TYPE *const h, size_t i, const size_t len) \
+{ \
+    const TYPE x = h[i]; \
+    for (size_t c; (c = 2 * i + 1) < len; i = c) { \
+        if (c + 1 < len && BEFORE(h[c], h[c + 1])) \
+            ++c; \
+        if (!BEFORE(x, h[c])) \
+            break; \
+        h[i] = h[c]; \
+    } \
+    h[i] = x; \
+} \
+static inline void NAME(TYPE *const base, const size_t n, const size_t nel) \
+{ \
+    if (!base || !n || n > nel) \
+        return; \
+    for (size_t i = n / 2; i-- > 0; ) \
+        NAME##_sift(base, i, n); \
+    for (size_t i = n; i < nel; ++i) \
+        if (BEFORE(base[i], base[0])) { \
+            base[0] = base[i]; \
+            NAME##_sift(base, 0, n); \
+        } \
+    for (size_t len = n - 1; len > 0; --len) { \
+        const TYPE tmp = base[0]; \
+        base[0] = base[len]; \
+        base[len] = tmp; \
+        NAME##_sift(base, 0, len); \
+    } \
+}
+
+// Largest ints, sorted descending
+TOPN_DEFINE(topn_int, int, TOPN_DESC)
+
+// Streaming selector of the 'n' largest integer keys, each with a pointer
+// payload, without indirect calls. Caller supplies buffer of n TopNItem.
+typedef struct topnitem {
+    long key;
+    void *ptr;
+} TopNItem;
+
+typedef struct topnkeys {
+    TopNItem *item;
+    size_t n, len;
+} TopNKeys;
+
+// Restore min-heap from index i down
+static inline void topn_keys_sift(TopNItem *const h, size_t i, const size_t len)
+{
+    const TopNItem x = h[i];
+    for (size_t c; (c = 2 * i + 1) < len; i = c) {
+        if (c + 1 < len && h[c + 1].key < h[c].key)
+            ++c;
+        if (x.key <= h[c].key)
+            break;
+        h[i] = h[c];
+    }
+    h[i] = x;
+}
+
+// Offer key with pointer payload
+static inline void topn_keys_push(TopNKeys *const sel, const long key, void *const ptr)
+{
+    TopNItem *const h = sel->item;
+    if (sel->len < sel->n) {
+        size_t i = sel->len++;  // sift up
+        for (size_t p; i && h[p = (i - 1) / 2].key > key; i = p)
+            h[i] = h[p];
+        h[i] = (TopNItem){key, ptr};
+    } else if (sel->n && key > h[0].key) {
+        h[0] = (TopNItem){key, ptr};
+        topn_keys_sift(h, 0, sel->n);
+    }
+}
+
+// Sort descending by key, return number of items
+// NB: after this, the selector is no longer a heap; do not push any more
+static inline size_t topn_keys_sort(TopNKeys *const sel)
+{
+    for (size_t len = sel->len; len-- > 1; ) {
+        const TopNItem tmp = sel->item[0];
+        sel->item[0] = sel->item[len];
+        sel->item[len] = tmp;
+        topn_keys_sift(sel->item, 0, len);
+    }
+    return sel->len;
+}
+
 #endif //  TOPN_H
@@ -0,0 +1,65 @@
+#include <stdlib.h>   // malloc, free, size_t
+#include <string.h>   // memcpy
+#include <pthread.h>  // pthread_create, pthread_join
+#include "topn.h"
+#include "cores.h"
+
+// Arbitrary limit to avoid dynamic allocation of thread arrays.
+#define MAXTHREADS 64
+
+typedef struct work {
+    const unsigned char *beg;
+    size_t nel;
+    TopN sel;
+} Work;
+
+// Parallel execution in separate threads: top 'n' of one slice.
+static void *loop(void *arg)
+{
+    Work *w = arg;
+    for (size_t i = 0; i < w->nel; ++i)
+        topn_push(&w->sel, w->beg + w->sel.width * i);
+    return NULL;
+}
+
+int topn_parallel(void *base, const size_t n, const size_t nel, const size_t width,
+                  int (*cmp)(const void *, const void *), const int threads)
+{
+    // Sanity check, avoid undefined behaviour
+    if (!n || n > nel || !width || !base || !cmp)
+        return 0;
+    int t = threads > 0 ? (threads > MAXTHREADS ? MAXTHREADS : threads) : coresavail(1, MAXTHREADS);
+    if ((size_t)t > nel / n)
+        t = (int)(nel / n);  // at least 'n' elements per slice
+    if (t <= 1) {
+        topn(base, n, nel, width, cmp);
+        return 0;
+    }
+
+    // One buffer for all per-thread selectors, plus the merged result
+    unsigned char *const buf = malloc(width * n * (size_t)(t + 1));
+    if (!buf)
+        return -1;
+    pthread_t tid[MAXTHREADS];
+    Work work[MAXTHREADS];
+    const unsigned char *const cbase = base;
+    for (int i = 0; i < t; ++i) {
+        const size_t beg = nel * (size_t)i / (size_t)t;
+        const size_t end = nel * (size_t)(i + 1) / (size_t)t;
+        work[i].beg = cbase + width * beg;
+        work[i].nel = end - beg;
+        topn_init(&work[i].sel, buf + width * n * (size_t)i, n, width, cmp);
+        pthread_create(&tid[i], NULL, loop, &work[i]);
+    }
+    TopN all;
+    topn_init(&all, buf + width * n * (size_t)t, n, width, cmp);
+    for (int i = 0; i < t; ++i) {
+        pthread_join(tid[i], NULL);
+        topn_merge(&all, &work[i].sel);
+    }
+    topn_sort(&all);
+
+    memcpy(base, all.base, width * n);
+    free(buf);
+    return 0;
+}